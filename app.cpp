@@ -3,6 +3,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include "imgui.h"
@@ -10,6 +11,8 @@
 #include "imgui_internal.h"
 
 #include "widgets.h"
+#include "profiler.h"
+#include "memory_tracker.h"
 
 #ifndef EMSCRIPTEN
 #include "nfd.h"
@@ -17,10 +20,19 @@
 
 #include "fonts/embedded_font.inc"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 void DrawMenu();
+void HandleEditShortcuts();
+void DrawRecoverPrompt();
 void DrawToolbar(ImVec2 buttonSize);
 
 #define DEFINE_APP_THEME_NAMES
@@ -28,6 +40,10 @@ void DrawToolbar(ImVec2 buttonSize);
 #include "editing.h"
 #include "inspector.h"
 #include "timeline.h"
+#include "timeline_cache.h"
+#include "autosave.h"
+#include "undo.h"
+#include "mapped_file.h"
 #include "colors.h"
 
 const char* app_name = "Raven";
@@ -58,6 +74,15 @@ void Message(const char* format, ...) {
     Log(appState.message);
 }
 
+// Move a finished temporary file over the real one. On POSIX the rename
+// replaces it atomically; Windows won't rename over an existing file.
+bool RenameOver(const std::string& temp_path, const std::string& path) {
+#ifdef _WIN32
+    remove(path.c_str());
+#endif
+    return rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
 // C forever <3
 std::string Format(const char* format, ...) {
     char buf[1000]; // for this app, this will suffice.
@@ -235,40 +260,323 @@ std::string otio_error_string(otio::ErrorStatus const& error_status) {
         + error_status.details;
 }
 
-void LoadTimeline(otio::Timeline* timeline) {
-    OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
-    op->SetTimeline(timeline);
+// Swap in a timeline whose provider has already been built
+void LoadProvider(std::unique_ptr<OTIOProvider>&& provider) {
+    otio::Timeline* timeline = provider->OtioTimeline();
+    DocumentWillChange();
+    ClearUndo();
+    appState.timelinePH.SetProvider(std::move(provider));
     DetectPlayheadLimits();
     appState.timelinePH.playhead = appState.timelinePH.PlayheadLimit().start_time();
     FitZoomWholeTimeline();
     SelectObject(timeline);
 }
 
-void LoadFile(std::string path) {
-    auto start = std::chrono::high_resolution_clock::now();
+void LoadTimeline(otio::Timeline* timeline) {
+    std::unique_ptr<OTIOProvider> provider;
+    {
+        MemoryScope scope(MemoryTag_Provider);
+        provider = std::make_unique<OTIOProvider>();
+        provider->SetTimeline(timeline);
+    }
+    LoadProvider(std::move(provider));
+    // not from a file, so there's nowhere to journal beside
+    AutosaveDocumentClosed();
+}
 
+// A file being loaded on a worker thread. The worker holds its own
+// reference, so a cancelled load can run to completion in the background
+// and simply be thrown away. Workers are joined, not detached, so none is
+// left running once raven starts to exit.
+struct PendingLoad {
+    std::string path;
+    std::chrono::high_resolution_clock::time_point start;
+
+    std::atomic<const char*> stage { "Opening" };
+    std::atomic<float> progress { 0.0f };
+    std::atomic<bool> cancelled { false };
+    std::atomic<bool> finished { false };
+    std::atomic<bool> exited { false };   // the worker has returned
+    bool use_cache = false;
+    bool recover = false;   // from the autosave journal, instead of the file
+
+    // only touched by the worker until finished is set
+    std::unique_ptr<OTIOProvider> provider;
+    bool from_cache = false;
+    std::string error;
+    std::string warning;
+};
+
+static std::shared_ptr<PendingLoad> pendingLoad;
+
+// Runs on the worker thread. Parsing is a single call into OTIO, so the
+// progress is reported per stage.
+//
+// OTIO parses a file as a stream, through a small buffer, constructing
+// each object as soon as its JSON closes, so the file is never held in
+// memory as a whole. Peak memory is then about the size of the finished
+// timeline. The file is only mapped, not read, to key the index cache.
+static void LoadFileWorker(std::shared_ptr<PendingLoad> load) {
+    const float parse_share = 0.85f;
+    MemoryScope document_scope(MemoryTag_Document);
+
+    if (load->recover) {
+        load->stage = "Recovering";
+        auto timeline = RecoverAutosave(load->path, &load->error, &load->warning);
+        if (load->cancelled)
+            return;
+        if (timeline) {
+            load->stage = "Indexing";
+            load->progress = parse_share;
+            MemoryScope provider_scope(MemoryTag_Provider);
+            auto provider = std::make_unique<OTIOProvider>();
+            provider->SetTimeline(timeline);
+            load->provider = std::move(provider);
+            load->progress = 1.0f;
+        }
+        load->finished = true;
+        return;
+    }
+
+    TimelineCacheKey cache_key;
+    if (load->use_cache) {
+        load->stage = "Checking cache";
+        MappedFile file;
+        if (!file.Open(load->path)) {
+            load->error = "Cannot open file";
+            load->finished = true;
+            return;
+        }
+        cache_key = TimelineCacheKeyFor(load->path, file.data(), file.size());
+        if (load->cancelled)
+            return;
+    }
+
+    load->stage = "Parsing";
     otio::ErrorStatus error_status;
-    auto timeline = dynamic_cast<otio::Timeline*>(
-        otio::Timeline::from_json_file(path, &error_status));
-    if (!timeline || otio::is_error(error_status)) {
+    otio::SerializableObject::Retainer<otio::SerializableObject> object(
+        otio::SerializableObject::from_json_file(load->path, &error_status));
+    if (load->cancelled)
+        return;
+    auto timeline = otio::dynamic_retainer_cast<otio::Timeline>(object);
+    if (otio::is_error(error_status)) {
+        load->error = otio_error_string(error_status);
+        load->finished = true;
+        return;
+    }
+    if (!timeline) {
+        load->error = "File does not contain a Timeline";
+        load->finished = true;
+        return;
+    }
+    load->progress = parse_share;
+
+    load->stage = "Indexing";
+    MemoryScope provider_scope(MemoryTag_Provider);
+    auto provider = std::make_unique<OTIOProvider>();
+    auto cache_path = TimelineCachePath(load->path);
+    load->from_cache = load->use_cache
+        && TimelineCache::Read(cache_path, cache_key, timeline, provider.get());
+    if (!load->from_cache) {
+        provider->SetTimeline(timeline);
+    }
+    if (load->cancelled)
+        return;
+    if (load->use_cache && !load->from_cache) {
+        if (!TimelineCache::Write(cache_path, cache_key, *provider))
+            Log("Could not write index cache \"%s\"", cache_path.c_str());
+    }
+    load->provider = std::move(provider);
+    load->progress = 1.0f;
+    load->finished = true;
+}
+
+struct LoadWorker {
+    std::shared_ptr<PendingLoad> load;
+    std::thread thread;
+};
+static std::vector<LoadWorker> loadWorkers;
+
+// Join the workers that have returned, or all of them if asked to wait
+static void JoinLoadWorkers(bool wait) {
+    for (auto it = loadWorkers.begin(); it != loadWorkers.end();) {
+        if (wait || it->load->exited) {
+            it->thread.join();
+            it = loadWorkers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static void StartLoadWorker(std::shared_ptr<PendingLoad> load) {
+    JoinLoadWorkers(false);
+    loadWorkers.push_back({ load, std::thread([load]() {
+        // e.g. running out of memory on a very large file, which is
+        // reported like any other failure to load, not left to terminate
+        try {
+            LoadFileWorker(load);
+        } catch (const std::exception& e) {
+            load->error = e.what();
+            load->provider.reset();
+            load->finished = true;
+        }
+        load->exited = true;
+    }) });
+}
+
+void LoadFile(std::string path) {
+    CancelLoad();
+
+    auto load = std::make_shared<PendingLoad>();
+    load->path = path;
+    load->start = std::chrono::high_resolution_clock::now();
+    load->use_cache = appState.use_index_cache;
+    pendingLoad = load;
+
+    StartLoadWorker(load);
+}
+
+// Load the edits to path that were journaled but never saved
+void RecoverFile(std::string path) {
+    CancelLoad();
+
+    auto load = std::make_shared<PendingLoad>();
+    load->path = path;
+    load->start = std::chrono::high_resolution_clock::now();
+    load->recover = true;
+    pendingLoad = load;
+
+    StartLoadWorker(load);
+}
+
+void CancelLoad() {
+    if (!pendingLoad)
+        return;
+    pendingLoad->cancelled = true;
+    Message("Cancelled loading \"%s\"", pendingLoad->path.c_str());
+    pendingLoad.reset();
+}
+
+bool IsLoading(const char** stage, float* progress) {
+    if (!pendingLoad)
+        return false;
+    if (stage)
+        *stage = pendingLoad->stage;
+    if (progress)
+        *progress = pendingLoad->progress;
+    return true;
+}
+
+// A file that was opened with unsaved edits journaled from before, and
+// that the user hasn't yet been asked about
+static std::string recoverPromptPath;
+
+// Called at the top of each frame, so a finished load is swapped in
+// before anything draws from the provider.
+static void FinishLoad() {
+    if (!pendingLoad || !pendingLoad->finished)
+        return;
+
+    auto load = pendingLoad;
+    pendingLoad.reset();
+
+    if (!load->provider) {
         Message(
             "Error loading \"%s\": %s",
-            path.c_str(),
-            otio_error_string(error_status).c_str());
+            load->path.c_str(),
+            load->error.c_str());
         return;
     }
 
-    LoadTimeline(timeline);
+    otio::SerializableObject::Retainer<otio::Timeline> timeline =
+        load->provider->OtioTimeline();
+    LoadProvider(std::move(load->provider));
+
+    appState.file_path = load->path;
+    AutosaveDocumentOpened(load->path, load->recover);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = (end - load->start);
+    double elapsed_seconds = elapsed.count();
+    if (load->recover) {
+        Message(
+            "Recovered \"%s\" in %.3f seconds%s%s",
+            timeline->name().c_str(),
+            elapsed_seconds,
+            load->warning != "" ? ". " : "",
+            load->warning.c_str());
+    } else if (AutosaveRecoverable(load->path)) {
+        Message(
+            "\"%s\" has unsaved edits from before",
+            timeline->name().c_str());
+        recoverPromptPath = load->path;
+    } else {
+        Message(
+            "Loaded \"%s\" in %.3f seconds%s",
+            timeline->name().c_str(),
+            elapsed_seconds,
+            load->from_cache ? " (indexed from cache)" : "");
+    }
+}
+
+// A save in progress. The worker writes a clone of the timeline, taken
+// when the save started, so the document can go on being edited meanwhile.
+struct PendingSave {
+    std::string path;
+    std::string name;
+    std::chrono::high_resolution_clock::time_point start;
+    double snapshot_seconds = 0;
+    std::future<std::string> error;    // empty once saved
+};
+
+static std::unique_ptr<PendingSave> pendingSave;
+
+// Runs on the worker thread
+static std::string WriteTimelineFile(
+    otio::SerializableObject::Retainer<otio::Timeline> timeline,
+    std::string path) {
+    std::string temp_path = path + ".saving";
+    otio::ErrorStatus error_status;
+    auto success = timeline->to_json_file(temp_path, &error_status);
+    if (!success || otio::is_error(error_status)) {
+        remove(temp_path.c_str());
+        return otio_error_string(error_status);
+    }
+    if (!RenameOver(temp_path, path)) {
+        remove(temp_path.c_str());
+        return "Cannot replace file";
+    }
+    return "";
+}
+
+// Report the result of the running save, waiting for it if asked to.
+static void FinishSave(bool wait) {
+    if (!pendingSave)
+        return;
+    if (!wait && pendingSave->error.wait_for(std::chrono::seconds(0))
+                     != std::future_status::ready)
+        return;
 
-    appState.file_path = path;
+    auto save = std::move(pendingSave);
+    auto error = save->error.get();
+    AutosaveDocumentSaved(save->path, error == "");
+    if (error != "") {
+        Message(
+            "Error saving \"%s\": %s",
+            save->path.c_str(),
+            error.c_str());
+        return;
+    }
 
     auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = (end - start);
+    std::chrono::duration<double> elapsed = (end - save->start);
     double elapsed_seconds = elapsed.count();
     Message(
-        "Loaded \"%s\" in %.3f seconds",
-        timeline->name().c_str(),
-        elapsed_seconds);
+        "Saved \"%s\" in %.3f seconds (%.3f seconds to snapshot)",
+        save->name.c_str(),
+        elapsed_seconds,
+        save->snapshot_seconds);
 }
 
 void SaveFile(std::string path) {
@@ -277,27 +585,40 @@ void SaveFile(std::string path) {
     if (!timeline)
         return;
 
-    auto start = std::chrono::high_resolution_clock::now();
+    // one at a time, so two saves never write the same file
+    FinishSave(true);
+
+    auto save = std::make_unique<PendingSave>();
+    save->path = path;
+    save->name = timeline->name();
+    save->start = std::chrono::high_resolution_clock::now();
 
     otio::ErrorStatus error_status;
-    auto success = timeline->to_json_file(path, &error_status);
-    if (!success || otio::is_error(error_status)) {
+    otio::SerializableObject::Retainer<otio::SerializableObject> object(
+        timeline->clone(&error_status));
+    auto snapshot = otio::dynamic_retainer_cast<otio::Timeline>(object);
+    if (!snapshot || otio::is_error(error_status)) {
         Message(
             "Error saving \"%s\": %s",
             path.c_str(),
             otio_error_string(error_status).c_str());
         return;
     }
-
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = (end - start);
-    double elapsed_seconds = elapsed.count();
-    Message(
-        "Saved \"%s\" in %.3f seconds",
-        timeline->name().c_str(),
-        elapsed_seconds);
+    std::chrono::duration<double> snapshot_elapsed =
+        std::chrono::high_resolution_clock::now() - save->start;
+    save->snapshot_seconds = snapshot_elapsed.count();
+
+    save->error = std::async(std::launch::async, WriteTimelineFile, snapshot, path);
+    pendingSave = std::move(save);
+    AutosaveDocumentSaving(path);
+    Message("Saving \"%s\"...", path.c_str());
 }
 
+// Set by --memory-report <path|->. The report is written once the file
+// given with it has loaded and drawn, and then raven exits.
+static std::string memoryReportPath;
+static int memoryReportFrames = 2;
+
 void MainInit(int argc, char** argv, int initial_width, int initial_height) {
     appState.timelinePH.timeline_width = initial_width * 0.8f;
 
@@ -312,15 +633,33 @@ void MainInit(int argc, char** argv, int initial_width, int initial_height) {
     appState.timelinePH.SetProvider(std::make_unique<OTIOProvider>());
     appState.timelinePH.drawPanZoomer = true;
 
-    if (argc > 1) {
-        LoadFile(argv[1]);
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--memory-report") && i + 1 < argc) {
+            memoryReportPath = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path != "") {
+        LoadFile(path);
     } else {
         //auto tl = new otio::Timeline();
         //LoadTimeline(tl);
     }
 }
 
-void MainCleanup() { }
+void MainCleanup() {
+    // don't leave a half written file behind
+    FinishSave(true);
+    // a load still running would go on using statics as they're destroyed
+    CancelLoad();
+    JoinLoadWorkers(true);
+    // journals an edit that was still being dragged
+    ClearUndo();
+    AutosaveShutdown();
+}
 
 // Make a button using the fancy icon font
 bool IconButton(const char* label, const ImVec2 size = ImVec2(0, 0)) {
@@ -328,10 +667,37 @@ bool IconButton(const char* label, const ImVec2 size = ImVec2(0, 0)) {
     return result;
 }
 
-void AppUpdate() { }
+static void UpdateMemoryReport() {
+    if (memoryReportPath == "" || IsLoading(nullptr, nullptr))
+        return;
+    // let the panels draw the document first
+    if (memoryReportFrames-- > 0)
+        return;
+    if (!WriteMemoryReport(memoryReportPath)) {
+        Log("Could not write memory report \"%s\"", memoryReportPath.c_str());
+    }
+    memoryReportPath = "";
+#ifndef EMSCRIPTEN
+    MainCleanup();
+    exit(0);
+#endif
+}
+
+void AppUpdate() {
+    FinishLoad();
+    JoinLoadWorkers(false);
+    FinishSave(false);
+    AutosaveUpdate();
+    UndoUpdate();
+    UpdateMemoryReport();
+}
 
 void MainGui() {
-    AppUpdate();
+    ProfilerBeginFrame();
+    {
+        ProfileScope scope("AppUpdate");
+        AppUpdate();
+    }
 
     char window_title[1024];
     auto filename = appState.file_path.substr(appState.file_path.find_last_of("/\\") + 1);
@@ -391,6 +757,7 @@ void MainGui() {
     }
 
     DrawMenu();
+    HandleEditShortcuts();
 
     // ImGui::SameLine(ImGui::GetContentRegionAvailWidth() - button_size.x +
     // style.ItemSpacing.x);
@@ -470,7 +837,11 @@ void MainGui() {
         contentSize.y -= ImGui::GetTextLineHeightWithSpacing() + 7;
         ImGui::BeginChild("##TimelineContainer", contentSize);
 
-        DrawTimeline(&appState.timelinePH);
+        {
+            ProfileScope scope("DrawTimeline");
+            MemoryScope memory_scope(MemoryTag_Renderer);
+            DrawTimeline(&appState.timelinePH);
+        }
 
         ImGui::EndChild();
 
@@ -483,6 +854,8 @@ void MainGui() {
     ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
     visible = ImGui::Begin("Inspector", NULL, window_flags);
     if (visible) {
+        ProfileScope scope("DrawInspector");
+        MemoryScope memory_scope(MemoryTag_Inspector);
         DrawInspector(&appState.timelinePH);
     }
     ImGui::End();
@@ -490,6 +863,8 @@ void MainGui() {
     ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
     visible = ImGui::Begin("JSON", NULL, window_flags);
     if (visible) {
+        ProfileScope scope("DrawJSONInspector");
+        MemoryScope memory_scope(MemoryTag_JSON);
         DrawJSONInspector();
     }
     ImGui::End();
@@ -497,6 +872,8 @@ void MainGui() {
     ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
     visible = ImGui::Begin("Markers", NULL, window_flags);
     if (visible) {
+        ProfileScope scope("DrawMarkersInspector");
+        MemoryScope memory_scope(MemoryTag_Inspector);
         DrawMarkersInspector(&appState.timelinePH);
     }
     ImGui::End();
@@ -540,6 +917,56 @@ void MainGui() {
     if (appState.show_implot_demo_window) {
         ImPlot::ShowDemoWindow();
     }
+
+    if (appState.show_profiler) {
+        DrawProfiler(&appState.show_profiler);
+    }
+
+    if (appState.show_memory) {
+        DrawMemoryPanel(&appState.show_memory);
+    }
+
+    DrawRecoverPrompt();
+
+    ProfilerEndFrame();
+}
+
+// Ask whether to recover the unsaved edits to the file just opened. Until
+// they're recovered or discarded, they're kept, and edits to the file
+// aren't journaled.
+void DrawRecoverPrompt() {
+    const char* title = "Recover Unsaved Edits?";
+    if (recoverPromptPath != "" && recoverPromptPath == appState.file_path) {
+        if (!ImGui::IsPopupOpen(title))
+            ImGui::OpenPopup(title);
+    } else {
+        recoverPromptPath = "";
+    }
+    if (!ImGui::BeginPopupModal(title, NULL, ImGuiWindowFlags_AlwaysAutoResize))
+        return;
+
+    auto filename = recoverPromptPath.substr(recoverPromptPath.find_last_of("/\\") + 1);
+    ImGui::Text("\"%s\" has edits from an earlier session that were never saved.", filename.c_str());
+    ImGui::Text("Recover them, or discard them for good?");
+    ImGui::Separator();
+    if (ImGui::Button("Recover")) {
+        RecoverFile(recoverPromptPath);
+        recoverPromptPath = "";
+        ImGui::CloseCurrentPopup();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Discard")) {
+        AutosaveDiscard(recoverPromptPath);
+        Message("Discarded the unsaved edits to \"%s\"", filename.c_str());
+        recoverPromptPath = "";
+        ImGui::CloseCurrentPopup();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Decide Later")) {
+        recoverPromptPath = "";
+        ImGui::CloseCurrentPopup();
+    }
+    ImGui::EndPopup();
 }
 
 void SaveTheme() {
@@ -583,12 +1010,12 @@ std::string OpenFileDialog() {
 #endif
 }
 
-std::string SaveFileDialog() {
+std::string SaveFileDialog(const char* filter) {
 #ifdef EMSCRIPTEN
     return "";
 #else
     nfdchar_t* outPath = NULL;
-    nfdresult_t result = NFD_SaveDialog("otio", NULL, &outPath);
+    nfdresult_t result = NFD_SaveDialog(filter, NULL, &outPath);
     if (result == NFD_OKAY) {
         auto result = std::string(outPath);
         free(outPath);
@@ -602,6 +1029,22 @@ std::string SaveFileDialog() {
 #endif
 }
 
+// Text fields have their own undo, so leave the keys to them while typing
+void HandleEditShortcuts() {
+    ImGuiIO& io = ImGui::GetIO();
+    if (io.WantTextInput || !io.KeyCtrl)
+        return;
+    if (ImGui::IsKeyPressed(ImGuiKey_Z)) {
+        if (io.KeyShift) {
+            Redo();
+        } else {
+            Undo();
+        }
+    } else if (ImGui::IsKeyPressed(ImGuiKey_Y)) {
+        Redo();
+    }
+}
+
 void DrawMenu() {
     if (ImGui::BeginMenuBar()) {
         if (ImGui::BeginMenu("File")) {
@@ -618,12 +1061,26 @@ void DrawMenu() {
             if (ImGui::MenuItem("Revert")) {
                 LoadFile(appState.file_path);
             }
+            if (ImGui::MenuItem("Recover Unsaved Edits", NULL, false,
+                                !IsLoading() && AutosaveRecoverable(appState.file_path))) {
+                RecoverFile(appState.file_path);
+            }
+            if (ImGui::MenuItem("Discard Unsaved Edits", NULL, false,
+                                !IsLoading() && AutosaveRecoverable(appState.file_path))) {
+                AutosaveDiscard(appState.file_path);
+                Message("Discarded the unsaved edits to \"%s\"", appState.file_path.c_str());
+            }
+            ImGui::MenuItem("Cache Index Beside Files", NULL, &appState.use_index_cache);
             OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
             otio::Timeline* timeline = op->OtioTimeline();
             if (ImGui::MenuItem("Close", NULL, false,
                                 timeline)) {
+                CancelLoad();
+                ClearUndo();
+                DocumentWillChange();
                 op->SetTimeline(nullptr);
                 SelectObject(NULL);
+                AutosaveDocumentClosed();
             }
 #ifndef EMSCRIPTEN
             // You can't exit(0) from a web page
@@ -637,6 +1094,16 @@ void DrawMenu() {
         }
 
         if (ImGui::BeginMenu("Edit")) {
+            char label[64];
+            snprintf(label, sizeof(label), "Undo %s###Undo", UndoName());
+            if (ImGui::MenuItem(label, "Ctrl+Z", false, CanUndo())) {
+                Undo();
+            }
+            snprintf(label, sizeof(label), "Redo %s###Redo", RedoName());
+            if (ImGui::MenuItem(label, "Ctrl+Shift+Z", false, CanRedo())) {
+                Redo();
+            }
+            ImGui::Separator();
             if (ImGui::MenuItem(
                     "Snap to Frames",
                     NULL,
@@ -706,6 +1173,9 @@ void DrawMenu() {
                 FitZoomWholeTimeline();
             }
             ImGui::Separator();
+            if (ImGui::MenuItem("Profiler", NULL, &appState.show_profiler)) { }
+            if (ImGui::MenuItem("Memory", NULL, &appState.show_memory)) { }
+            ImGui::Separator();
             ImGui::Text("Dear ImGui:");
             ImGui::Indent();
             if (ImGui::MenuItem("Metrics", NULL, &appState.show_metrics)) { }
@@ -753,7 +1223,19 @@ void DrawToolbar(ImVec2 button_size) {
     ImGui::Text("\xef\x81\x9a"); // (i) icon
     ImGui::PopStyleColor();
     ImGui::SameLine();
-    ImGui::Text("%s", appState.message);
+    const char* load_stage = nullptr;
+    float load_progress = 0.0f;
+    if (IsLoading(&load_stage, &load_progress)) {
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%s...", load_stage);
+        ImGui::ProgressBar(load_progress, ImVec2(200, button_size.y), overlay);
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel", ImVec2(0, button_size.y))) {
+            CancelLoad();
+        }
+    } else {
+        ImGui::Text("%s", appState.message);
+    }
 
 #ifdef THEME_EDITOR
     for (int i = 0; i < AppThemeCol_COUNT; i++) {
@@ -773,7 +1255,7 @@ void DrawToolbar(ImVec2 button_size) {
 #ifdef SHOW_FPS
     // skip to the far right edge
     ImGui::SameLine();
-    ImGui::Dummy(ImVec2(ImGui::GetContentRegionAvail().x; - 250, 5));
+    ImGui::Dummy(ImVec2(ImGui::GetContentRegionAvail().x - 250, 5));
 
     int fps = rint(1.0f / ImGui::GetIO().DeltaTime);
     ImGui::PushStyleColor(
@@ -793,17 +1275,11 @@ void SelectObject(
     OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
     appState.timelinePH.selected_object = op->NodeFromOtio(object);
     appState.selected_context = context;
+    UpdateJSONInspector(object);
+}
 
-    if (object == NULL) {
-        appState.selected_text = "No selection";
-    } else {
-        otio::ErrorStatus error_status;
-        appState.selected_text = object->to_json_string(&error_status);
-        if (otio::is_error(error_status)) {
-            appState.selected_text = otio_error_string(error_status);
-        }
-    }
-    UpdateJSONInspector();
+void DocumentWillChange() {
+    InvalidateJSONInspector();
 }
 
 void SeekPlayhead(double seconds) {
@@ -830,42 +1306,35 @@ void FitZoomWholeTimeline() {
         appState.timelinePH.timeline_width / r.duration().to_seconds();
 }
 
+int DisplayTimeFormatFlags(bool allow_rate) {
+    int flags = 0;
+    if (appState.display_timecode)
+        flags |= TimeFormat_Timecode;
+    if (appState.display_frames)
+        flags |= TimeFormat_Frames;
+    if (appState.display_seconds)
+        flags |= TimeFormat_Seconds;
+    if (allow_rate && appState.display_rate)
+        flags |= TimeFormat_Rate;
+    return flags;
+}
+
+const char* FormattedStringFromTime(char* buf, size_t size, otio::RationalTime time, bool allow_rate) {
+    return FormatTime(buf, size, time, DisplayTimeFormatFlags(allow_rate), appState.drop_frame_mode);
+}
+
+const char* TimecodeStringFromTime(char* buf, size_t size, otio::RationalTime time) {
+    return FormatTime(buf, size, time, TimeFormat_Timecode, appState.drop_frame_mode);
+}
+
 std::string FormattedStringFromTime(otio::RationalTime time, bool allow_rate) {
-    std::string result;
-    if (appState.display_timecode) {
-        if (result != "")
-            result += "\n";
-        result += TimecodeStringFromTime(time);
-    }
-    if (appState.display_frames) {
-        if (result != "")
-            result += "\n";
-        result += FramesStringFromTime(time) + "f";
-    }
-    if (appState.display_seconds) {
-        if (result != "")
-            result += "\n";
-        result += SecondsStringFromTime(time) + "s";
-    }
-    if (allow_rate && appState.display_rate) {
-        if (result != "")
-            result += "\n";
-        result += "@" + Format("%.3f", time.rate());
-    }
-    return result;
+    char buf[TimeStringSize];
+    return FormattedStringFromTime(buf, sizeof(buf), time, allow_rate);
 }
 
 std::string TimecodeStringFromTime(otio::RationalTime time) {
-    opentime::ErrorStatus error_status;
-    auto result = time.to_timecode(time.rate(), appState.drop_frame_mode, &error_status);
-    if (opentime::is_error(error_status)) {
-        // non-standard rates can't be turned into timecode
-        // so fall back to a time string, which is HH:MM:SS.xxx
-        // where xxx is a fraction instead of a :FF frame.
-        return time.to_time_string();
-    } else {
-        return result;
-    }
+    char buf[TimeStringSize];
+    return TimecodeStringFromTime(buf, sizeof(buf), time);
 }
 
 std::string FramesStringFromTime(otio::RationalTime time) {
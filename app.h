@@ -8,6 +8,7 @@
 #include "imgui_internal.h"
 
 #include "timeline.h"
+#include "timecode.h"
 
 #include <opentimelineio/timeline.h>
 namespace otio = opentimelineio::OPENTIMELINEIO_VERSION;
@@ -96,11 +97,14 @@ struct AppState {
     bool display_rate = false;
     opentime::IsDropFrameRate drop_frame_mode = opentime::InferFromRate;
 
+    // Keep a .ravencache file next to each file opened, so that reopening
+    // it unchanged doesn't have to index it from scratch
+    bool use_index_cache = false;
+
     // Selection.
     otio::SerializableObject*
         selected_context; // often NULL, parent to the selected object for OTIO
     // objects which don't track their parent
-    std::string selected_text; // displayed in the JSON inspector
     char message[1024]; // single-line message displayed in main window
 
     // Toggles for Dear ImGui windows
@@ -109,6 +113,8 @@ struct AppState {
     bool show_demo_window = false;
     bool show_metrics = false;
     bool show_implot_demo_window = false;
+    bool show_profiler = false;
+    bool show_memory = false;
 };
 
 extern AppState appState;
@@ -118,9 +124,18 @@ extern ImFont* gFont;
 void Log(const char* format, ...);
 void Message(const char* format, ...);
 std::string Format(const char* format, ...);
+bool RenameOver(const std::string& temp_path, const std::string& path);
 
 std::string otio_error_string(otio::ErrorStatus const& error_status);
 
+std::string SaveFileDialog(const char* filter = "otio");
+
+void LoadTimeline(otio::Timeline* timeline);
+void LoadFile(std::string path);
+void RecoverFile(std::string path);
+void CancelLoad();
+bool IsLoading(const char** stage = nullptr, float* progress = nullptr);
+
 void SelectObject(
     otio::SerializableObject* object,
     otio::SerializableObject* context = NULL);
@@ -130,6 +145,17 @@ void DetectPlayheadLimits();
 void FitZoomWholeTimeline();
 std::string FormattedStringFromTime(otio::RationalTime time, bool allow_rate = true);
 std::string TimecodeStringFromTime(otio::RationalTime);
+// The same, written into buf without allocating. buf should hold at least
+// raven::TimeStringSize characters. Returns buf.
+const char* FormattedStringFromTime(char* buf, size_t size, otio::RationalTime time, bool allow_rate = true);
+const char* TimecodeStringFromTime(char* buf, size_t size, otio::RationalTime time);
+// The raven::TimeFormatFlags_ that the display settings ask for
+int DisplayTimeFormatFlags(bool allow_rate = true);
 std::string FramesStringFromTime(otio::RationalTime);
 std::string SecondsStringFromTime(otio::RationalTime);
-void UpdateJSONInspector();
+void UpdateJSONInspector(otio::SerializableObject* object);
+void InvalidateJSONInspector();
+
+// Call before mutating the document, so that anything reading it in the
+// background is finished and cached views of it are dropped.
+void DocumentWillChange();
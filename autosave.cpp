@@ -0,0 +1,927 @@
+// Autosave journal
+
+#include "autosave.h"
+#include "app.h"
+
+#include "imgui.h"
+
+#include <opentimelineio/composition.h>
+#include <opentimelineio/effect.h>
+#include <opentimelineio/item.h>
+#include <opentimelineio/marker.h>
+#include <opentimelineio/stack.h>
+#include <opentimelineio/track.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace raven {
+
+// Which generations of the journal are current, as written to
+// file.otio.autosave. Generation `base` starts from base_path, which is
+// either a checkpoint or the document's own file as it was saved, and
+// each generation after it up to `last` continues from the one before.
+struct AutosaveIndex {
+    uint64_t first = 0;     // oldest generation with files on disk
+    uint64_t last = 0;      // the generation being appended to
+    uint64_t base = 0;      // newest generation whose starting point is on disk
+    std::string base_path;
+    int64_t base_size = 0;  // base_path is only used if it still matches
+    int64_t base_mtime = 0;
+};
+
+// Records since the last checkpoint before another is taken
+static const size_t autosaveCheckpointRecords = 500;
+
+// Only touched on the UI thread
+static struct {
+    std::string path;           // the document's file, empty if there isn't one
+    int64_t size = 0;           // of that file, as last opened or saved
+    int64_t mtime = 0;
+    bool active = false;        // journaling, since the first edit
+    AutosaveIndex index;        // as last written
+    size_t records = 0;         // written since the last checkpoint or save
+    bool needs_checkpoint = false;  // an edit couldn't be journaled
+    bool blocked = false;       // edits went unjournaled, for a journal from before
+    uint64_t saving_gen = 0;    // the generation a save in progress is the base of
+    uint64_t checkpoint_gen = 0;
+    std::future<bool> checkpoint;
+} autosave;
+
+// Runs file operations one after another, in the order they were posted,
+// on a thread of its own.
+class AutosaveWriter {
+public:
+    AutosaveWriter() : _thread(&AutosaveWriter::Run, this) { }
+
+    // finishes everything posted so far
+    ~AutosaveWriter() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _wake.notify_one();
+        _thread.join();
+    }
+
+    void Post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(std::move(task));
+        }
+        _wake.notify_one();
+    }
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            _wake.wait(lock, [this]() { return _quit || !_tasks.empty(); });
+            if (_tasks.empty())
+                return;
+            auto task = std::move(_tasks.front());
+            _tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<std::function<void()>> _tasks;
+    bool _quit = false;
+    std::thread _thread;
+};
+
+static AutosaveWriter* autosaveWriter = nullptr;
+
+// Only touched on the writer's thread
+static FILE* journalFile = NULL;
+
+static void PostAutosaveTask(std::function<void()> task) {
+    if (!autosaveWriter)
+        autosaveWriter = new AutosaveWriter();
+    autosaveWriter->Post(std::move(task));
+}
+
+static std::string AutosaveIndexPath(const std::string& path) {
+    return path + ".autosave";
+}
+
+static std::string AutosaveGenerationPath(const std::string& path, uint64_t gen, const char* extension) {
+    return Format("%s.autosave.%llu.%s", path.c_str(), (unsigned long long)gen, extension);
+}
+
+static bool FileKey(const std::string& path, int64_t* size, int64_t* mtime) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    *size = (int64_t)info.st_size;
+    *mtime = (int64_t)info.st_mtime;
+    return true;
+}
+
+static bool BaseIsCurrent(const AutosaveIndex& index) {
+    int64_t size, mtime;
+    return index.base != 0 && FileKey(index.base_path, &size, &mtime)
+        && size == index.base_size && mtime == index.base_mtime;
+}
+
+static bool ReadTextFile(const std::string& path, std::string* text) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return false;
+    char buffer[64 * 1024];
+    size_t count;
+    text->clear();
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text->append(buffer, count);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+static bool ReadAutosaveIndex(const std::string& path, AutosaveIndex* index) {
+    std::string text;
+    if (!ReadTextFile(AutosaveIndexPath(path), &text))
+        return false;
+    *index = AutosaveIndex();
+    size_t pos = 0;
+    bool valid = false;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos)
+            eol = text.size();
+        std::string line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        unsigned long long gen;
+        long long size, mtime;
+        int path_start = 0;
+        if (line == "raven-autosave 1") {
+            valid = true;
+        } else if (sscanf(line.c_str(), "first %llu", &gen) == 1) {
+            index->first = gen;
+        } else if (sscanf(line.c_str(), "last %llu", &gen) == 1) {
+            index->last = gen;
+        } else if (sscanf(line.c_str(), "base %llu %lld %lld %n", &gen, &size, &mtime, &path_start) == 3
+                   && path_start > 0) {
+            index->base = gen;
+            index->base_size = size;
+            index->base_mtime = mtime;
+            index->base_path = line.substr(path_start);
+        }
+    }
+    return valid && index->first <= index->base && index->base <= index->last;
+}
+
+// Write a file whole, beside its final name, then swap it in
+static bool WriteFileAtomically(const std::string& path, const std::string& text) {
+    std::string temp_path = path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = fclose(file) == 0 && ok;
+    if (ok)
+        ok = RenameOver(temp_path, path);
+    if (!ok)
+        remove(temp_path.c_str());
+    return ok;
+}
+
+static void WriteAutosaveIndex() {
+    const auto& index = autosave.index;
+    std::string text = Format(
+        "raven-autosave 1\nfirst %llu\nlast %llu\nbase %llu %lld %lld %s\n",
+        (unsigned long long)index.first,
+        (unsigned long long)index.last,
+        (unsigned long long)index.base,
+        (long long)index.base_size,
+        (long long)index.base_mtime,
+        index.base_path.c_str());
+    std::string index_path = AutosaveIndexPath(autosave.path);
+    PostAutosaveTask([index_path, text]() {
+        if (!WriteFileAtomically(index_path, text))
+            Log("Could not write autosave index \"%s\"", index_path.c_str());
+    });
+}
+
+static void OpenJournal(uint64_t gen) {
+    std::string journal_path = AutosaveGenerationPath(autosave.path, gen, "journal");
+    PostAutosaveTask([journal_path]() {
+        if (journalFile)
+            fclose(journalFile);
+        journalFile = fopen(journal_path.c_str(), "ab");
+        if (journalFile == NULL)
+            Log("Could not open autosave journal \"%s\"", journal_path.c_str());
+    });
+}
+
+static void CloseJournal() {
+    PostAutosaveTask([]() {
+        if (journalFile)
+            fclose(journalFile);
+        journalFile = NULL;
+    });
+}
+
+// remove the journals and checkpoints of generations [first, last)
+static void RemoveGenerations(const std::string& path, uint64_t first, uint64_t last) {
+    PostAutosaveTask([path, first, last]() {
+        for (uint64_t gen = first; gen < last; ++gen) {
+            remove(AutosaveGenerationPath(path, gen, "journal").c_str());
+            remove(AutosaveGenerationPath(path, gen, "otio").c_str());
+        }
+    });
+}
+
+// move on to a new generation, whose records follow whatever the
+// previous ones left off at
+static void RotateJournal() {
+    autosave.index.last++;
+    OpenJournal(autosave.index.last);
+    WriteAutosaveIndex();
+}
+
+// The starting point of generation gen, base_path, is on disk, so the
+// generations before it are no longer needed
+static bool LandBase(uint64_t gen, const std::string& base_path) {
+    int64_t size, mtime;
+    if (gen <= autosave.index.base || !FileKey(base_path, &size, &mtime))
+        return false;
+    uint64_t old_first = autosave.index.first;
+    autosave.index.first = gen;
+    autosave.index.base = gen;
+    autosave.index.base_path = base_path;
+    autosave.index.base_size = size;
+    autosave.index.base_mtime = mtime;
+    WriteAutosaveIndex();
+    RemoveGenerations(autosave.path, old_first, gen);
+    return true;
+}
+
+// Runs on a worker thread
+static bool WriteCheckpoint(otio::SerializableObject::Retainer<otio::Timeline> timeline,
+                            std::string path) {
+    std::string temp_path = path + ".tmp";
+    otio::ErrorStatus error_status;
+    auto success = timeline->to_json_file(temp_path, &error_status);
+    if (!success || otio::is_error(error_status) || !RenameOver(temp_path, path)) {
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void FinishCheckpoint() {
+    uint64_t gen = autosave.checkpoint_gen;
+    std::string checkpoint_path = AutosaveGenerationPath(autosave.path, gen, "otio");
+    if (!autosave.checkpoint.get()) {
+        Log("Could not write autosave checkpoint \"%s\"", checkpoint_path.c_str());
+        return;
+    }
+    if (!LandBase(gen, checkpoint_path)) {
+        // a save got there first
+        PostAutosaveTask([checkpoint_path]() { remove(checkpoint_path.c_str()); });
+    }
+}
+
+// Snapshot the document, and write it out in the background as the base
+// of a new generation. The clone is the only part on the UI thread.
+static void StartCheckpoint() {
+    if (autosave.checkpoint.valid())
+        FinishCheckpoint();
+
+    otio::SerializableObject::Retainer<otio::Timeline> snapshot;
+    OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
+    otio::Timeline* timeline = op ? op->OtioTimeline().value : nullptr;
+    if (timeline) {
+        otio::ErrorStatus error_status;
+        otio::SerializableObject::Retainer<otio::SerializableObject> object(
+            timeline->clone(&error_status));
+        snapshot = otio::dynamic_retainer_cast<otio::Timeline>(object);
+        if (otio::is_error(error_status)) {
+            Log("Could not snapshot for autosave: %s", otio_error_string(error_status).c_str());
+            snapshot = nullptr;
+        }
+    }
+
+    RotateJournal();
+    autosave.records = 0;
+    autosave.needs_checkpoint = false;
+    if (!snapshot)
+        return;
+    autosave.checkpoint_gen = autosave.index.last;
+    autosave.checkpoint = std::async(
+        std::launch::async,
+        WriteCheckpoint,
+        snapshot,
+        AutosaveGenerationPath(autosave.path, autosave.checkpoint_gen, "otio"));
+}
+
+// The first edit since the document was opened or saved starts a journal
+// from the file as it is on disk. Returns false while a journal from
+// before is still recoverable; that's only removed when the user says so.
+static bool StartSession() {
+    AutosaveIndex old;
+    if (ReadAutosaveIndex(autosave.path, &old)) {
+        if (AutosaveRecoverable(autosave.path)) {
+            if (!autosave.blocked)
+                Message("Edits aren't being autosaved until the unsaved edits from before are recovered or discarded");
+            autosave.blocked = true;
+            return false;
+        }
+        // left from before, but the file has changed since, so it can't
+        // be replayed over it any more
+        RemoveGenerations(autosave.path, old.first, old.last + 1);
+    }
+
+    autosave.index = AutosaveIndex();
+    autosave.index.first = 1;
+    autosave.index.last = 1;
+    autosave.index.base = 1;
+    autosave.index.base_path = autosave.path;
+    autosave.index.base_size = autosave.size;
+    autosave.index.base_mtime = autosave.mtime;
+    autosave.active = true;
+    autosave.records = 0;
+    // edits made while blocked aren't in the file, so start from a
+    // checkpoint as soon as there's a chance
+    autosave.needs_checkpoint = autosave.blocked;
+    autosave.blocked = false;
+    OpenJournal(1);
+    WriteAutosaveIndex();
+    return true;
+}
+
+static void EndSession(bool discard) {
+    if (autosave.checkpoint.valid())
+        FinishCheckpoint();
+    if (!autosave.active)
+        return;
+    CloseJournal();
+    if (discard) {
+        RemoveGenerations(autosave.path, autosave.index.first, autosave.index.last + 1);
+        std::string index_path = AutosaveIndexPath(autosave.path);
+        PostAutosaveTask([index_path]() { remove(index_path.c_str()); });
+    }
+    autosave.active = false;
+    autosave.saving_gen = 0;
+    autosave.needs_checkpoint = false;
+}
+
+void AutosaveDocumentOpened(const std::string& path, bool recovered) {
+    EndSession(false);
+    autosave.path = path;
+    autosave.size = 0;
+    autosave.mtime = 0;
+    FileKey(path, &autosave.size, &autosave.mtime);
+    autosave.records = 0;
+    autosave.blocked = false;
+
+    AutosaveIndex index;
+    if (recovered && ReadAutosaveIndex(path, &index)) {
+        // Carry on from what was recovered. The last journal may end in a
+        // half written record, so start a new generation from a checkpoint.
+        autosave.index = index;
+        autosave.active = true;
+        StartCheckpoint();
+    }
+}
+
+void AutosaveDocumentClosed() {
+    EndSession(false);
+    autosave.path.clear();
+}
+
+void AutosaveDocumentSaving(const std::string& path) {
+    if (!autosave.active || path != autosave.path)
+        return;
+    // edits from here on follow the saved file
+    RotateJournal();
+    autosave.saving_gen = autosave.index.last;
+    autosave.records = 0;
+}
+
+void AutosaveDocumentSaved(const std::string& path, bool success) {
+    if (path != autosave.path)
+        return;
+    if (success)
+        FileKey(path, &autosave.size, &autosave.mtime);
+    uint64_t gen = autosave.saving_gen;
+    autosave.saving_gen = 0;
+    if (!autosave.active || gen == 0 || !success)
+        return;
+    if (autosave.records == 0 && autosave.index.last == gen) {
+        // nothing has changed since
+        EndSession(true);
+        return;
+    }
+    LandBase(gen, path);
+}
+
+void AutosaveUpdate() {
+    if (autosave.checkpoint.valid()
+        && autosave.checkpoint.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        FinishCheckpoint();
+    }
+    // The clone is taken on this thread, so wait for a moment when
+    // nothing is being dragged or typed into
+    if (autosave.active && !autosave.checkpoint.valid()
+        && (autosave.needs_checkpoint || autosave.records >= autosaveCheckpointRecords)
+        && ImGui::GetActiveID() == 0) {
+        StartCheckpoint();
+    }
+}
+
+void AutosaveShutdown() {
+    EndSession(false);
+    delete autosaveWriter;
+    autosaveWriter = nullptr;
+}
+
+// Records
+//
+// Each is a line of text, "<op> <path> <size> <hash>", followed by size
+// bytes of OTIO JSON and a newline. The hash covers the JSON, so that a
+// record cut short by a crash is recognised and skipped.
+//
+// A path leads from the timeline's top-level stack, "/", through lists of
+// children (c), markers (m) and effects (e), e.g. "/c2/c14/m0" for the
+// first marker on the fifteenth item of the third track. The timeline
+// itself is "T".
+
+static uint64_t HashRecord(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static char AutosaveListCode(AutosaveList list) {
+    switch (list) {
+    case AutosaveList_Markers:
+        return 'm';
+    case AutosaveList_Effects:
+        return 'e';
+    default:
+        return 'c';
+    }
+}
+
+template<typename T>
+static int IndexInList(const std::vector<otio::SerializableObject::Retainer<T>>& list,
+                       otio::SerializableObject* object) {
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i].value == object)
+            return (int)i;
+    }
+    return -1;
+}
+
+static std::string ChildPath(const std::string& parent_path, char list, int index) {
+    return Format("%s%s%c%d", parent_path.c_str(), parent_path == "/" ? "" : "/", list, index);
+}
+
+// where object is in the document, found through the provider, since
+// markers and effects don't know their item
+static bool ObjectPath(otio::SerializableObject* object, std::string* path) {
+    OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
+    otio::Timeline* timeline = op->OtioTimeline();
+    if (!timeline)
+        return false;
+    if (object == timeline) {
+        *path = "T";
+        return true;
+    }
+
+    std::vector<std::string> steps;
+    TimelineNode node = op->NodeFromOtio(object);
+    if (node == TimelineNodeNull())
+        return false;
+    while (node != RootNodeId()) {
+        TimelineNode parent = op->HasParent(node);
+        auto child = op->OtioFromNode(node).value;
+        auto item = dynamic_cast<otio::Item*>(op->OtioFromNode(parent).value);
+        if (!item)
+            return false;
+        char list = 'c';
+        int index = -1;
+        if (op->Kind(node) == TimelineProvider::NodeKind::Marker) {
+            list = 'm';
+            index = IndexInList(item->markers(), child);
+        } else if (op->Kind(node) == TimelineProvider::NodeKind::Effect) {
+            list = 'e';
+            index = IndexInList(item->effects(), child);
+        } else if (const auto& composition = dynamic_cast<otio::Composition*>(item)) {
+            index = IndexInList(composition->children(), child);
+        }
+        if (index < 0)
+            return false;
+        steps.push_back(Format("/%c%d", list, index));
+        node = parent;
+    }
+
+    path->clear();
+    for (auto it = steps.rbegin(); it != steps.rend(); ++it) {
+        path->append(*it);
+    }
+    if (path->empty())
+        *path = "/";
+    return true;
+}
+
+static otio::SerializableObject* ListElement(otio::SerializableObject* parent, AutosaveList list, int index) {
+    if (index < 0)
+        return nullptr;
+    if (list == AutosaveList_Children) {
+        auto composition = dynamic_cast<otio::Composition*>(parent);
+        if (composition && index < (int)composition->children().size())
+            return composition->children()[index].value;
+    } else if (auto item = dynamic_cast<otio::Item*>(parent)) {
+        if (list == AutosaveList_Markers && index < (int)item->markers().size())
+            return item->markers()[index].value;
+        if (list == AutosaveList_Effects && index < (int)item->effects().size())
+            return item->effects()[index].value;
+    }
+    return nullptr;
+}
+
+// The fields of a timeline or composition without everything below it, so
+// that renaming a track doesn't journal the whole track
+static otio::SerializableObject::Retainer<otio::SerializableObject> FieldsOf(otio::SerializableObject* object) {
+    if (const auto& timeline = dynamic_cast<otio::Timeline*>(object)) {
+        return new otio::Timeline(timeline->name(), timeline->global_start_time(), timeline->metadata());
+    }
+    if (const auto& track = dynamic_cast<otio::Track*>(object)) {
+        return new otio::Track(track->name(), track->source_range(), track->kind(), track->metadata());
+    }
+    if (const auto& stack = dynamic_cast<otio::Stack*>(object)) {
+        return new otio::Stack(stack->name(), stack->source_range(), stack->metadata());
+    }
+    return object;
+}
+
+// Every edit must reach the journal, or replaying it would go wrong from
+// there on. One that can't be described is covered by a checkpoint instead,
+// taken by AutosaveUpdate once the UI is idle. Until then, later records
+// would follow a gap, so they're left to the checkpoint too.
+static void RequestCheckpoint() {
+    autosave.needs_checkpoint = true;
+}
+
+static void WriteRecord(const char* op, const std::string& path, otio::SerializableObject* object) {
+    if (autosave.needs_checkpoint)
+        return;
+    std::string payload;
+    if (object) {
+        otio::ErrorStatus error_status;
+        payload = object->to_json_string(&error_status);
+        if (otio::is_error(error_status)) {
+            Log("Could not journal an edit: %s", otio_error_string(error_status).c_str());
+            RequestCheckpoint();
+            return;
+        }
+    }
+
+    std::string record = Format(
+        "%s %s %llu %016llx\n",
+        op,
+        path.c_str(),
+        (unsigned long long)payload.size(),
+        (unsigned long long)HashRecord(payload.data(), payload.size()));
+    record.append(payload);
+    record.push_back('\n');
+    autosave.records++;
+    PostAutosaveTask([record]() {
+        if (journalFile) {
+            fwrite(record.data(), 1, record.size(), journalFile);
+            fflush(journalFile);
+        }
+    });
+}
+
+static bool BeginRecord() {
+    if (autosave.path.empty())
+        return false;
+    return autosave.active || StartSession();
+}
+
+void AutosaveObjectChanged(otio::SerializableObject* object) {
+    if (!BeginRecord())
+        return;
+    std::string path;
+    if (!ObjectPath(object, &path)) {
+        RequestCheckpoint();
+        return;
+    }
+    auto fields = FieldsOf(object);
+    WriteRecord("set", path, fields.value);
+}
+
+// The timeline's tracks are the children of its top-level stack, "/"
+static otio::SerializableObject* ListOwner(otio::SerializableObject* parent) {
+    if (const auto& timeline = dynamic_cast<otio::Timeline*>(parent))
+        return timeline->tracks();
+    return parent;
+}
+
+void AutosaveChildInserted(otio::SerializableObject* parent, AutosaveList list, int index) {
+    if (!BeginRecord())
+        return;
+    std::string path;
+    parent = ListOwner(parent);
+    auto child = ListElement(parent, list, index);
+    if (!child || !ObjectPath(parent, &path)) {
+        RequestCheckpoint();
+        return;
+    }
+    WriteRecord("insert", ChildPath(path, AutosaveListCode(list), index), child);
+}
+
+void AutosaveChildRemoved(otio::SerializableObject* parent, AutosaveList list, int index) {
+    if (!BeginRecord())
+        return;
+    std::string path;
+    if (!ObjectPath(ListOwner(parent), &path)) {
+        RequestCheckpoint();
+        return;
+    }
+    WriteRecord("remove", ChildPath(path, AutosaveListCode(list), index), nullptr);
+}
+
+// Replay
+
+struct AutosavePathStep {
+    char list;
+    int index;
+};
+
+static bool ParseRecordPath(const char* text, bool* is_timeline, std::vector<AutosavePathStep>* steps) {
+    steps->clear();
+    *is_timeline = strcmp(text, "T") == 0;
+    if (*is_timeline)
+        return true;
+    if (strcmp(text, "/") == 0)
+        return true;
+    while (*text == '/') {
+        AutosavePathStep step;
+        int length = 0;
+        if (sscanf(text, "/%c%d%n", &step.list, &step.index, &length) != 2 || length == 0)
+            return false;
+        if (step.list != 'c' && step.list != 'm' && step.list != 'e')
+            return false;
+        steps->push_back(step);
+        text += length;
+    }
+    return *text == '\0' && !steps->empty();
+}
+
+// follow the first count steps down from the top-level stack
+static otio::SerializableObject* ResolvePath(otio::Timeline* timeline,
+                                             const std::vector<AutosavePathStep>& steps,
+                                             size_t count) {
+    otio::SerializableObject* object = timeline->tracks();
+    for (size_t i = 0; i < count && object; ++i) {
+        AutosaveList list = steps[i].list == 'm' ? AutosaveList_Markers
+                          : steps[i].list == 'e' ? AutosaveList_Effects
+                                                 : AutosaveList_Children;
+        object = ListElement(object, list, steps[i].index);
+    }
+    return object;
+}
+
+// copy what FieldsOf keeps
+static bool CopyFields(otio::SerializableObject* target, otio::SerializableObject* source) {
+    if (const auto& timeline = dynamic_cast<otio::Timeline*>(target)) {
+        auto fields = dynamic_cast<otio::Timeline*>(source);
+        if (!fields)
+            return false;
+        timeline->set_name(fields->name());
+        timeline->set_global_start_time(fields->global_start_time());
+        timeline->metadata() = fields->metadata();
+        return true;
+    }
+    auto composition = dynamic_cast<otio::Composition*>(target);
+    auto fields = dynamic_cast<otio::Composition*>(source);
+    if (!composition || !fields)
+        return false;
+    composition->set_name(fields->name());
+    composition->set_source_range(fields->source_range());
+    composition->metadata() = fields->metadata();
+    if (const auto& track = dynamic_cast<otio::Track*>(target)) {
+        if (const auto& track_fields = dynamic_cast<otio::Track*>(source))
+            track->set_kind(track_fields->kind());
+    }
+    return true;
+}
+
+template<typename T>
+static bool EditAnnotationList(std::vector<otio::SerializableObject::Retainer<T>>& list,
+                               const std::string& op,
+                               int index,
+                               otio::SerializableObject* object) {
+    if (op == "remove") {
+        if (index < 0 || index >= (int)list.size())
+            return false;
+        list.erase(list.begin() + index);
+        return true;
+    }
+    auto annotation = dynamic_cast<T*>(object);
+    if (!annotation)
+        return false;
+    if (op == "insert") {
+        if (index < 0 || index > (int)list.size())
+            return false;
+        list.insert(list.begin() + index, annotation);
+        return true;
+    }
+    if (index < 0 || index >= (int)list.size())
+        return false;
+    list[index] = annotation;
+    return true;
+}
+
+static bool EditList(otio::SerializableObject* parent,
+                     const std::string& op,
+                     AutosavePathStep step,
+                     otio::SerializableObject* object) {
+    if (step.list == 'c') {
+        auto composition = dynamic_cast<otio::Composition*>(parent);
+        if (!composition)
+            return false;
+        otio::ErrorStatus error_status;
+        if (op == "remove") {
+            composition->remove_child(step.index, &error_status);
+        } else {
+            auto child = dynamic_cast<otio::Composable*>(object);
+            if (!child)
+                return false;
+            if (op == "insert") {
+                composition->insert_child(step.index, child, &error_status);
+            } else {
+                composition->set_child(step.index, child, &error_status);
+            }
+        }
+        return !otio::is_error(error_status);
+    }
+    auto item = dynamic_cast<otio::Item*>(parent);
+    if (!item)
+        return false;
+    if (step.list == 'm')
+        return EditAnnotationList(item->markers(), op, step.index, object);
+    return EditAnnotationList(item->effects(), op, step.index, object);
+}
+
+static bool ApplyRecord(otio::Timeline* timeline,
+                        const std::string& op,
+                        const char* path,
+                        const std::string& payload) {
+    bool is_timeline;
+    std::vector<AutosavePathStep> steps;
+    if (!ParseRecordPath(path, &is_timeline, &steps))
+        return false;
+
+    otio::SerializableObject::Retainer<otio::SerializableObject> object;
+    if (op != "remove") {
+        otio::ErrorStatus error_status;
+        object = otio::SerializableObject::from_json_string(payload, &error_status);
+        if (!object || otio::is_error(error_status))
+            return false;
+    }
+
+    if (op == "set") {
+        if (is_timeline)
+            return CopyFields(timeline, object.value);
+        auto target = ResolvePath(timeline, steps, steps.size());
+        if (dynamic_cast<otio::Composition*>(target))
+            return CopyFields(target, object.value);
+        if (!target || steps.empty())
+            return false;
+    } else if (op != "insert" && op != "remove") {
+        return false;
+    }
+    if (is_timeline || steps.empty())
+        return false;
+    auto parent = ResolvePath(timeline, steps, steps.size() - 1);
+    return parent && EditList(parent, op, steps.back(), object.value);
+}
+
+// Apply the records of one journal, as far as they go. Returns false at
+// a record that is incomplete, or that was written whole but couldn't be
+// applied, after which no later record can be trusted either. Records
+// find their objects by index, so skipping one would send those after it
+// to the wrong place. A torn record is only expected at the end of the
+// last journal, cut short by the crash.
+static bool ReplayJournal(otio::Timeline* timeline,
+                          const std::string& journal_path,
+                          bool last,
+                          std::string* warning) {
+    std::string text;
+    if (!ReadTextFile(journal_path, &text))
+        return true;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        char op[16];
+        char path[1024];
+        unsigned long long size, hash;
+        bool whole = eol != std::string::npos
+            && eol - pos < 1100
+            && sscanf(text.substr(pos, eol - pos).c_str(), "%15s %1023s %llu %llx", op, path, &size, &hash) == 4
+            && size <= text.size() - eol - 1
+            && eol + 1 + size < text.size()
+            && text[eol + 1 + size] == '\n'
+            && HashRecord(text.data() + eol + 1, size) == hash;
+        if (!whole) {
+            if (last) {
+                *warning = "The last edits before the crash were incomplete, and were skipped";
+            } else {
+                *warning = "An earlier journal was incomplete, so the edits from there on were skipped";
+            }
+            return false;
+        }
+        if (!ApplyRecord(timeline, op, path, text.substr(eol + 1, size))) {
+            *warning = Format("An edit could not be replayed; recovered up to %s", path);
+            return false;
+        }
+        pos = eol + 1 + size + 1;
+    }
+    return true;
+}
+
+bool AutosaveRecoverable(const std::string& path) {
+    if (path.empty() || (autosave.active && autosave.path == path))
+        return false;
+    AutosaveIndex index;
+    if (!ReadAutosaveIndex(path, &index) || !BaseIsCurrent(index))
+        return false;
+    for (uint64_t gen = index.base; gen <= index.last; ++gen) {
+        int64_t size, mtime;
+        if (FileKey(AutosaveGenerationPath(path, gen, "journal"), &size, &mtime) && size > 0)
+            return true;
+    }
+    return false;
+}
+
+void AutosaveDiscard(const std::string& path) {
+    if (path.empty() || (autosave.active && autosave.path == path))
+        return;
+    AutosaveIndex index;
+    if (ReadAutosaveIndex(path, &index))
+        RemoveGenerations(path, index.first, index.last + 1);
+    std::string index_path = AutosaveIndexPath(path);
+    PostAutosaveTask([index_path]() { remove(index_path.c_str()); });
+}
+
+otio::SerializableObject::Retainer<otio::Timeline> RecoverAutosave(
+    const std::string& path,
+    std::string* error,
+    std::string* warning) {
+    AutosaveIndex index;
+    if (!ReadAutosaveIndex(path, &index)) {
+        *error = "No autosave found";
+        return nullptr;
+    }
+    if (!BaseIsCurrent(index)) {
+        *error = Format("\"%s\" has changed since it was autosaved", index.base_path.c_str());
+        return nullptr;
+    }
+
+    otio::ErrorStatus error_status;
+    otio::SerializableObject::Retainer<otio::SerializableObject> object(
+        otio::SerializableObject::from_json_file(index.base_path, &error_status));
+    auto timeline = otio::dynamic_retainer_cast<otio::Timeline>(object);
+    if (otio::is_error(error_status)) {
+        *error = otio_error_string(error_status);
+        return nullptr;
+    }
+    if (!timeline) {
+        *error = "Autosave does not contain a Timeline";
+        return nullptr;
+    }
+
+    for (uint64_t gen = index.base; gen <= index.last; ++gen) {
+        if (!ReplayJournal(timeline, AutosaveGenerationPath(path, gen, "journal"), gen == index.last, warning))
+            break;
+    }
+    return timeline;
+}
+
+} // raven
@@ -0,0 +1,74 @@
+// Autosave journal
+#ifndef RAVEN_AUTOSAVE_H
+#define RAVEN_AUTOSAVE_H
+
+#include <opentimelineio/serializableObject.h>
+#include <opentimelineio/timeline.h>
+namespace otio = opentimelineio::OPENTIMELINEIO_VERSION;
+
+#include <string>
+
+namespace raven {
+
+// Edits to a document that was opened from a file are appended, as they
+// are made, to a journal beside it, by a background thread. Every so often
+// the document is cloned and written out whole as a checkpoint, and the
+// journal starts over from there. After a crash, the document is
+// recovered by replaying the journal over the last checkpoint, or over
+// the file itself if there isn't one yet.
+//
+// The files, all named after the document:
+//   file.otio.autosave             which generations are current
+//   file.otio.autosave.<N>.journal edits made during generation N
+//   file.otio.autosave.<N>.otio    the checkpoint that began generation N
+
+// The lists of child objects that edits insert into or remove from
+enum AutosaveList {
+    AutosaveList_Children,
+    AutosaveList_Markers,
+    AutosaveList_Effects
+};
+
+// Document lifecycle. Journaling starts with the first edit after a
+// document is opened, and stops when it is closed; a journal that is
+// left behind can be recovered the next time the file is opened. It's
+// kept until it is recovered or discarded, and edits to the file aren't
+// journaled over it meanwhile.
+void AutosaveDocumentOpened(const std::string& path, bool recovered);
+void AutosaveDocumentClosed();
+// Around a save. Once the document's own file is saved with no edits
+// after it, there's nothing left to recover, so the journal is removed.
+void AutosaveDocumentSaving(const std::string& path);
+void AutosaveDocumentSaved(const std::string& path, bool success);
+
+// Call once per frame, to start and finish checkpoints. They're only
+// started while no widget is active.
+void AutosaveUpdate();
+// Finish writing everything, before exiting
+void AutosaveShutdown();
+
+// Edit records. Call after the edit, once the provider has been notified.
+// Each serializes what changed on the calling thread, so an edit repeated
+// every frame, like a drag, should be recorded once it's finished.
+// An object's own fields changed:
+void AutosaveObjectChanged(otio::SerializableObject* object);
+// An object was inserted at, or removed from, index in one of parent's lists:
+void AutosaveChildInserted(otio::SerializableObject* parent, AutosaveList list, int index);
+void AutosaveChildRemoved(otio::SerializableObject* parent, AutosaveList list, int index);
+
+// Is there a journal of edits to path that were never saved?
+bool AutosaveRecoverable(const std::string& path);
+// Remove it, once the user has chosen not to recover it
+void AutosaveDiscard(const std::string& path);
+
+// Rebuild the document from the last checkpoint and the journals after
+// it. Replay stops at the first record that can't be read or applied,
+// e.g. one that was only half written, and says so in *warning.
+otio::SerializableObject::Retainer<otio::Timeline> RecoverAutosave(
+    const std::string& path,
+    std::string* error,
+    std::string* warning);
+
+} // raven
+
+#endif
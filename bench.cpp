@@ -0,0 +1,326 @@
+// Headless benchmark
+//
+// Replays a scripted sequence of zoom, scroll and selection frames through
+// the timeline, inspector and markers panels, with a Dear ImGui context but
+// no window or renderer, and reports CPU time and allocations per frame.
+//
+// Usage:
+//   raven_bench [file.otio] [--tracks N] [--clips M] [--markers K] [--frames F]
+//
+// Without a file, a synthetic timeline of N tracks, each with M clips and
+// K markers, is generated.
+
+#include "imgui.h"
+#include "implot.h"
+
+#include "app.h"
+#include "inspector.h"
+#include "main.h"
+#include "timeline.h"
+
+#include <opentimelineio/clip.h>
+#include <opentimelineio/gap.h>
+#include <opentimelineio/marker.h>
+#include <opentimelineio/stack.h>
+#include <opentimelineio/track.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace raven;
+
+// Count every heap allocation made by the process
+static std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    allocation_count++;
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    allocation_count++;
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+
+// There's no renderer to make textures with, so anything that would use
+// one draws without it.
+ImTextureID CreateRepeatingTexture(int width, int height, const unsigned char* rgba_pixels) {
+    return NULL;
+}
+
+struct BenchOptions {
+    std::string path;
+    int tracks = 20;
+    int clips = 500;
+    int markers = 50;
+    int frames = 600;
+};
+
+// The panels, plus the frame as a whole
+enum BenchMetric {
+    BenchMetric_Timeline,
+    BenchMetric_Inspector,
+    BenchMetric_Markers,
+    BenchMetric_Frame,
+    BenchMetric_COUNT
+};
+
+static const char* bench_metric_names[BenchMetric_COUNT] = {
+    "DrawTimeline",
+    "DrawInspector",
+    "DrawMarkersInspector",
+    "Frame"
+};
+
+static otio::Timeline* MakeSyntheticTimeline(const BenchOptions& options) {
+    const double rate = 24;
+    auto timeline = new otio::Timeline("Synthetic");
+    auto stack = timeline->tracks();
+    for (int t = 0; t < options.tracks; t++) {
+        auto kind = (t % 2) ? otio::Track::Kind::audio : otio::Track::Kind::video;
+        auto track = new otio::Track(Format("Track %d", t + 1), nonstd::nullopt, kind);
+        otio::ErrorStatus error_status;
+        stack->append_child(track, &error_status);
+        for (int c = 0; c < options.clips; c++) {
+            // vary the lengths a bit, so the tracks don't line up
+            double frames = 24 + ((c * 37 + t * 11) % 217);
+            otio::TimeRange range(
+                otio::RationalTime(0, rate),
+                otio::RationalTime(frames, rate));
+            otio::Composable* child;
+            if (c % 10 == 9) {
+                child = new otio::Gap(range);
+            } else {
+                auto clip = new otio::Clip(Format("Clip %d.%d", t + 1, c + 1), nullptr, range);
+                child = clip;
+            }
+            track->append_child(child, &error_status);
+        }
+        // spread the markers over the clips
+        auto& children = track->children();
+        for (int m = 0; m < options.markers && !children.empty(); m++) {
+            auto item = dynamic_cast<otio::Item*>(
+                children[(size_t)m * children.size() / options.markers].value);
+            if (!item || dynamic_cast<otio::Gap*>(item))
+                continue;
+            auto marker = new otio::Marker(
+                Format("Marker %d.%d", t + 1, m + 1),
+                otio::TimeRange(otio::RationalTime(m % 24, rate), otio::RationalTime(0, rate)));
+            item->markers().push_back(marker);
+        }
+    }
+    return timeline;
+}
+
+static otio::Timeline* LoadBenchTimeline(const std::string& path) {
+    otio::ErrorStatus error_status;
+    auto timeline = dynamic_cast<otio::Timeline*>(
+        otio::Timeline::from_json_file(path, &error_status));
+    if (!timeline || otio::is_error(error_status)) {
+        fprintf(
+            stderr,
+            "Error loading \"%s\": %s\n",
+            path.c_str(),
+            otio_error_string(error_status).c_str());
+        return nullptr;
+    }
+    return timeline;
+}
+
+static void CollectClips(otio::Composition* composition, std::vector<otio::Clip*>* clips) {
+    for (const auto& child : composition->children()) {
+        if (auto clip = dynamic_cast<otio::Clip*>(child.value)) {
+            clips->push_back(clip);
+        } else if (auto inner = dynamic_cast<otio::Composition*>(child.value)) {
+            CollectClips(inner, clips);
+        }
+    }
+}
+
+// Drive the view for frame i of the script: zoom in, then scroll across,
+// then select clips one after another.
+static void ScriptFrame(int i, int frames, double fit_scale, const std::vector<otio::Clip*>& clips) {
+    auto& tp = appState.timelinePH;
+    auto limit = tp.PlayheadLimit();
+    int phase_length = std::max(1, frames / 3);
+    int phase = std::min(2, i / phase_length);
+    double t = (double)(i % phase_length) / phase_length;
+
+    if (phase == 0) {
+        // from the whole timeline, down to a few frames across the window
+        const double max_scale = 2000.0;
+        tp.scale = fit_scale * pow(std::max(1.0, max_scale / fit_scale), t);
+        tp.playhead = limit.start_time() + otio::RationalTime::from_seconds(
+            limit.duration().to_seconds() * 0.5, tp.playhead.rate());
+        tp.scroll_to_playhead = true;
+    } else if (phase == 1) {
+        tp.Seek(limit.start_time().to_seconds() + limit.duration().to_seconds() * t);
+        tp.scroll_to_playhead = true;
+    } else if (!clips.empty()) {
+        auto clip = clips[(size_t)(i * 7919) % clips.size()];
+        SelectObject(clip);
+        otio::ErrorStatus error_status;
+        auto range = clip->range_in_parent(&error_status);
+        if (!otio::is_error(error_status)) {
+            tp.Seek(range.start_time().to_seconds());
+            tp.scroll_to_playhead = true;
+        }
+    }
+}
+
+static void ReportPercentiles(const char* name, std::vector<double> values, const char* units) {
+    if (values.empty())
+        return;
+    std::sort(values.begin(), values.end());
+    auto at = [&](double p) { return values[(size_t)(p * (values.size() - 1))]; };
+    printf(
+        "%-22s %10.3f %10.3f %10.3f %10.3f  %s\n",
+        name,
+        at(0.5),
+        at(0.9),
+        at(0.99),
+        values.back(),
+        units);
+}
+
+static bool ParseArgs(int argc, char** argv, BenchOptions* options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int* value = nullptr;
+        if (!strcmp(arg, "--tracks"))
+            value = &options->tracks;
+        else if (!strcmp(arg, "--clips"))
+            value = &options->clips;
+        else if (!strcmp(arg, "--markers"))
+            value = &options->markers;
+        else if (!strcmp(arg, "--frames"))
+            value = &options->frames;
+        else if (arg[0] != '-')
+            options->path = arg;
+        else
+            return false;
+        if (value) {
+            if (++i >= argc)
+                return false;
+            *value = atoi(argv[i]);
+        }
+    }
+    return options->tracks > 0 && options->clips > 0 && options->markers >= 0
+        && options->frames > 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseArgs(argc, argv, &options)) {
+        fprintf(
+            stderr,
+            "Usage: %s [file.otio] [--tracks N] [--clips M] [--markers K] [--frames F]\n",
+            argv[0]);
+        return 1;
+    }
+
+    // A context with no platform or renderer backend. Building the font
+    // atlas is all that NewFrame() needs.
+    ImGui::CreateContext();
+    ImPlot::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = NULL;
+    io.DisplaySize = ImVec2(1920, 1080);
+    io.DeltaTime = 1.0f / 60.0f;
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    auto load_start = std::chrono::steady_clock::now();
+    otio::Timeline* timeline = options.path.empty()
+        ? MakeSyntheticTimeline(options)
+        : LoadBenchTimeline(options.path);
+    if (!timeline)
+        return 1;
+    auto& tp = appState.timelinePH;
+    tp.timeline_width = io.DisplaySize.x * 0.8f;
+    LoadTimeline(timeline);
+    std::chrono::duration<double> load_elapsed = std::chrono::steady_clock::now() - load_start;
+
+    std::vector<otio::Clip*> clips;
+    CollectClips(timeline->tracks(), &clips);
+    double fit_scale = tp.scale;
+
+    printf(
+        "%s: %zu clips, %.3f seconds to build, %d frames\n",
+        options.path.empty() ? "synthetic" : options.path.c_str(),
+        clips.size(),
+        load_elapsed.count(),
+        options.frames);
+
+    std::vector<double> times[BenchMetric_COUNT];
+    std::vector<double> allocations;
+    typedef std::chrono::steady_clock Clock;
+    auto ms_since = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    for (int i = 0; i < options.frames; i++) {
+        ScriptFrame(i, options.frames, fit_scale, clips);
+
+        uint64_t allocations_before = allocation_count;
+        auto frame_start = Clock::now();
+        ImGui::NewFrame();
+
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(ImVec2(io.DisplaySize.x, io.DisplaySize.y * 0.6f));
+        ImGui::Begin("Timeline");
+        auto start = Clock::now();
+        DrawTimeline(&tp);
+        times[BenchMetric_Timeline].push_back(ms_since(start));
+        ImGui::End();
+
+        ImGui::SetNextWindowPos(ImVec2(0, io.DisplaySize.y * 0.6f));
+        ImGui::SetNextWindowSize(ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.4f));
+        ImGui::Begin("Inspector");
+        start = Clock::now();
+        DrawInspector(&tp);
+        times[BenchMetric_Inspector].push_back(ms_since(start));
+        ImGui::End();
+
+        ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.6f));
+        ImGui::SetNextWindowSize(ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.4f));
+        ImGui::Begin("Markers");
+        start = Clock::now();
+        DrawMarkersInspector(&tp);
+        times[BenchMetric_Markers].push_back(ms_since(start));
+        ImGui::End();
+
+        ImGui::Render();
+        times[BenchMetric_Frame].push_back(ms_since(frame_start));
+        allocations.push_back((double)(allocation_count - allocations_before));
+    }
+
+    printf("%-22s %10s %10s %10s %10s\n", "", "p50", "p90", "p99", "max");
+    for (int m = 0; m < BenchMetric_COUNT; m++) {
+        ReportPercentiles(bench_metric_names[m], times[m], "ms");
+    }
+    ReportPercentiles("Allocations", allocations, "per frame");
+
+    // let any background work on the document finish before tearing down
+    DocumentWillChange();
+    ImPlot::DestroyContext();
+    ImGui::DestroyContext();
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "editing.h"
 #include "app.h"
+#include "undo.h"
+#include "memory_tracker.h"
 
 #include <opentimelineio/effect.h>
 #include <opentimelineio/item.h>
@@ -14,15 +16,18 @@ void DeleteSelectedObject() {
     OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
     otio::Timeline* timeline = op->OtioTimeline();
     
-    otio::SerializableObject::Retainer<otio::Composable> otioNode =
+    otio::SerializableObject::Retainer<otio::SerializableObject> otioNode =
                         op->OtioFromNode(appState.timelinePH.selected_object);
     
     otio::Timeline* selectedTimeline = dynamic_cast<otio::Timeline*>(otioNode.value);
 
     if (timeline && (timeline == selectedTimeline)) {
         OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
+        DocumentWillChange();
         op->SetTimeline(nullptr);
         SelectObject(nullptr);
+        ClearUndo();
+        AutosaveDocumentClosed();
         return;
     }
 
@@ -35,20 +40,27 @@ void DeleteSelectedObject() {
                 selected_composable);
             if (it != children.end()) {
                 int index = (int)std::distance(children.begin(), it);
-                parent->remove_child(index);
+                EditRemoveChild(parent, AutosaveList_Children, index);
             }
         }
         SelectObject(NULL);
         return;
     }
 
+    // Markers and effects don't know their item, but the provider does
+    auto context = appState.selected_context;
+    if (context == NULL) {
+        context = op->OtioFromNode(op->HasParent(appState.timelinePH.selected_object));
+    }
+
     if (const auto& selected_marker =
             dynamic_cast<otio::Marker*>(otioNode.value)) {
-        if (const auto& item = dynamic_cast<otio::Item*>(appState.selected_context)) {
+        if (const auto& item = dynamic_cast<otio::Item*>(context)) {
             auto& markers = item->markers();
             auto it = std::find(markers.begin(), markers.end(), selected_marker);
             if (it != markers.end()) {
-                markers.erase(it);
+                int index = (int)std::distance(markers.begin(), it);
+                EditRemoveChild(item, AutosaveList_Markers, index);
             }
         }
         SelectObject(NULL);
@@ -56,11 +68,12 @@ void DeleteSelectedObject() {
     }
 
     if (const auto& selected_effect = dynamic_cast<otio::Effect*>(otioNode.value)) {
-        if (const auto& item = dynamic_cast<otio::Item*>(appState.selected_context)) {
+        if (const auto& item = dynamic_cast<otio::Item*>(context)) {
             auto& effects = item->effects();
             auto it = std::find(effects.begin(), effects.end(), selected_effect);
             if (it != effects.end()) {
-                effects.erase(it);
+                int index = (int)std::distance(effects.begin(), it);
+                EditRemoveChild(item, AutosaveList_Effects, index);
             }
         }
         SelectObject(NULL);
@@ -69,6 +82,7 @@ void DeleteSelectedObject() {
 }
 
 void AddMarkerAtPlayhead(otio::Item* item, std::string name, std::string color) {
+    MemoryScope scope(MemoryTag_Document);
     auto playhead = appState.timelinePH.playhead;
 
     OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
@@ -76,7 +90,7 @@ void AddMarkerAtPlayhead(otio::Item* item, std::string name, std::string color)
     if (!timeline)
         return;
 
-    otio::SerializableObject::Retainer<otio::Composable> otioNode =
+    otio::SerializableObject::Retainer<otio::SerializableObject> otioNode =
                         op->OtioFromNode(appState.timelinePH.selected_object);
 
     // Default to the selected item, or the top-level timeline.
@@ -104,10 +118,11 @@ void AddMarkerAtPlayhead(otio::Item* item, std::string name, std::string color)
     const auto marked_range = otio::TimeRange(time); // default 0 duration
     otio::SerializableObject::Retainer<otio::Marker> marker = new otio::Marker(name, marked_range, color);
 
-    item->markers().push_back(marker);
+    EditInsertChild(item, AutosaveList_Markers, (int)item->markers().size(), marker, &error_status);
 }
 
 void AddTrack(std::string kind) {
+    MemoryScope scope(MemoryTag_Document);
     OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
     otio::Timeline* timeline = op->OtioTimeline();
     if (!timeline)
@@ -117,7 +132,7 @@ void AddTrack(std::string kind) {
     int insertion_index = -1;
     otio::Stack* stack = timeline->tracks();
     
-    otio::SerializableObject::Retainer<otio::Composable> otioNode =
+    otio::SerializableObject::Retainer<otio::SerializableObject> otioNode =
                         op->OtioFromNode(appState.timelinePH.selected_object);
 
 
@@ -158,11 +173,9 @@ void AddTrack(std::string kind) {
 
         otio::ErrorStatus error_status;
         if (insertion_index == -1) {
-            stack->append_child(new_track, &error_status);
-        } else {
-            stack->insert_child(insertion_index, new_track, &error_status);
+            insertion_index = (int)stack->children().size();
         }
-        if (otio::is_error(error_status)) {
+        if (!EditInsertChild(stack, AutosaveList_Children, insertion_index, new_track, &error_status)) {
             Message(
                 "Error inserting track: %s",
                 otio_error_string(error_status).c_str());
@@ -172,6 +185,7 @@ void AddTrack(std::string kind) {
 }
 
 void FlattenTrackDown() {
+    MemoryScope scope(MemoryTag_Document);
     OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
     otio::Timeline* timeline = op->OtioTimeline();
     if (!timeline) {
@@ -184,7 +198,7 @@ void FlattenTrackDown() {
         return;
     }
 
-    otio::SerializableObject::Retainer<otio::Composable> otioNode =
+    otio::SerializableObject::Retainer<otio::SerializableObject> otioNode =
                         op->OtioFromNode(appState.timelinePH.selected_object);
     auto selected_track = dynamic_cast<otio::Track*>(otioNode.value);
     if (selected_track == NULL) {
@@ -230,9 +244,7 @@ void FlattenTrackDown() {
     }
     int insertion_index = selected_index + 1;
 
-    stack->insert_child(insertion_index, flat_track, &error_status);
-
-    if (otio::is_error(error_status)) {
+    if (!EditInsertChild(stack, AutosaveList_Children, insertion_index, flat_track, &error_status)) {
         Message(
             "Error inserting track: %s",
             otio_error_string(error_status).c_str());
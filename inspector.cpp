@@ -2,9 +2,12 @@
 
 #include "inspector.h"
 #include "app.h"
+#include "undo.h"
 #include "widgets.h"
 #include "editing.h"
 #include "colors.h"
+#include "json_viewer.h"
+#include "memory_tracker.h"
 
 #include <opentimelineio/anyDictionary.h>
 #include <opentimelineio/clip.h>
@@ -16,7 +19,11 @@
 #include <opentimelineio/transition.h>
 
 #include <implot.h>
-#include <TextEditor.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <unordered_map>
 
 using namespace raven;
 
@@ -26,60 +33,134 @@ static const char* marker_color_names[] = {
     "MAGENTA", "BLACK", "WHITE"
 };
 
-const TextEditor::LanguageDefinition& OTIOLanguageDef()
-{
-    static bool inited = false;
-    static TextEditor::LanguageDefinition langDef;
-    if (!inited)
-    {
-        static const char* const keywords[] = {
-            "true", "false", "null"
-        };
-
-        for (auto& k : keywords)
-            langDef.mKeywords.insert(k);
-
-        static const char* const identifiers[] = {
-            "\"OTIO_SCHEMA\""
-        };
-        for (auto& k : identifiers)
-        {
-            TextEditor::Identifier id;
-            id.mDeclaration = "OpenTimelineIO Schema";
-            langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
-        }
+JSONViewer jsonViewer;
+
+// The JSON text is produced lazily, only while the JSON window is visible,
+// and cached per object. Any edit to the document clears the cache, since
+// it changes the text of the edited object and all of its ancestors.
+static otio::SerializableObject::Retainer<otio::SerializableObject> jsonObject;
+static std::unordered_map<otio::SerializableObject*, std::shared_ptr<const JSONText>> jsonCache;
+static size_t jsonCacheBytes = 0;
+static const size_t jsonCacheBudget = 64 * 1024 * 1024;
+static uint64_t jsonRevision = 0;
+
+// What the viewer currently holds
+static otio::SerializableObject* jsonShown = nullptr;
+static uint64_t jsonShownRevision = 0;
+static bool jsonShownValid = false;
+
+// Compositions and timelines can be arbitrarily large, so they are
+// serialized on a worker thread. Only one runs at a time.
+//
+// The worker reads the document, so an edit has to wait for it. A job
+// isn't started while a widget is active, or until edits have stopped
+// for a moment, so a drag or a run of edits doesn't wait on one each
+// frame.
+static const double jsonSettleSeconds = 0.25;
+static double jsonEditTime = -1.0;
+
+struct JSONJob {
+    otio::SerializableObject::Retainer<otio::SerializableObject> object;
+    uint64_t revision;
+    std::future<std::shared_ptr<const JSONText>> text;
+};
+static std::unique_ptr<JSONJob> jsonJob;
+
+// The line index is built here too, so that for large objects it is also
+// off the UI thread.
+static std::shared_ptr<const JSONText> SerializeJSON(otio::SerializableObject* object) {
+    MemoryScope scope(MemoryTag_JSON);
+    otio::ErrorStatus error_status;
+    auto text = object->to_json_string(&error_status);
+    if (otio::is_error(error_status)) {
+        text = otio_error_string(error_status);
+    }
+    return MakeJSONText(std::move(text));
+}
 
-        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, TextEditor::PaletteIndex>("\\\"OTIO_SCHEMA\\\"", TextEditor::PaletteIndex::Identifier));
-        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, TextEditor::PaletteIndex>("\\\"(\\\\.|[^\\\"])*\\\"", TextEditor::PaletteIndex::String));
-        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, TextEditor::PaletteIndex>("[+-]?([0-9]+([.][0-9]*)?|[.][0-9]+)([eE][+-]?[0-9]+)?", TextEditor::PaletteIndex::Number));
-        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, TextEditor::PaletteIndex>("[a-zA-Z_][a-zA-Z0-9_]*", TextEditor::PaletteIndex::Identifier));
-        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, TextEditor::PaletteIndex>("[\\[\\]\\{\\}\\,\\:]", TextEditor::PaletteIndex::Punctuation));
+static void CacheJSON(otio::SerializableObject* object, std::shared_ptr<const JSONText> text) {
+    if (jsonCacheBytes + text->MemoryUsage() > jsonCacheBudget) {
+        jsonCache.clear();
+        jsonCacheBytes = 0;
+    }
+    jsonCacheBytes += text->MemoryUsage();
+    jsonCache[object] = text;
+}
 
-        langDef.mCommentStart = "/*";
-        langDef.mCommentEnd = "*/";
-        langDef.mSingleLineComment = "//";
+// Collect the result of the running job, waiting for it if asked to.
+static void FinishJSONJob(bool wait) {
+    if (!jsonJob)
+        return;
+    if (!wait && jsonJob->text.wait_for(std::chrono::seconds(0))
+                     != std::future_status::ready)
+        return;
+    auto text = jsonJob->text.get();
+    if (jsonJob->revision == jsonRevision) {
+        CacheJSON(jsonJob->object.value, text);
+    }
+    jsonJob.reset();
+}
 
-        langDef.mCaseSensitive = true;
-        langDef.mAutoIndentation = true;
+// Returns the cached text for the object, or nullptr while it is still
+// being serialized in the background.
+static std::shared_ptr<const JSONText> JSONTextFor(otio::SerializableObject* object) {
+    FinishJSONJob(false);
 
-        langDef.mName = "JSON";
+    auto it = jsonCache.find(object);
+    if (it != jsonCache.end())
+        return it->second;
 
-        inited = true;
+    if (dynamic_cast<otio::Composition*>(object) == nullptr &&
+        dynamic_cast<otio::Timeline*>(object) == nullptr) {
+        auto text = SerializeJSON(object);
+        CacheJSON(object, text);
+        return text;
     }
-    return langDef;
+
+    bool settled = ImGui::GetActiveID() == 0
+        && ImGui::GetTime() - jsonEditTime >= jsonSettleSeconds;
+    if (!jsonJob && settled) {
+        jsonJob = std::make_unique<JSONJob>();
+        jsonJob->object = object;
+        jsonJob->revision = jsonRevision;
+        jsonJob->text = std::async(std::launch::async, SerializeJSON, object);
+    }
+    return nullptr;
 }
 
-TextEditor jsonEditor;
-TextEditor::LanguageDefinition otioLangDef = OTIOLanguageDef();
+void UpdateJSONInspector(otio::SerializableObject* object) {
+    jsonObject = object;
+}
 
-void UpdateJSONInspector() {
-    jsonEditor.SetReadOnly(true);
-    jsonEditor.SetLanguageDefinition(otioLangDef);
-    jsonEditor.SetText(appState.selected_text);
+void InvalidateJSONInspector() {
+    // the document is about to change under the worker, so let it finish
+    FinishJSONJob(true);
+    jsonCache.clear();
+    jsonCacheBytes = 0;
+    jsonRevision++;
+    jsonEditTime = ImGui::GetTime();
 }
 
 void raven::DrawJSONInspector() {
-    jsonEditor.Render("JSON");
+    auto object = jsonObject.value;
+    if (!jsonShownValid || jsonShown != object || jsonShownRevision != jsonRevision) {
+        if (object == nullptr) {
+            jsonViewer.SetText(MakeJSONText("No selection"));
+            jsonShownValid = true;
+        } else if (const auto text = JSONTextFor(object)) {
+            jsonViewer.SetText(text);
+            jsonShownValid = true;
+        } else {
+            if (jsonShownValid || jsonShown != object) {
+                jsonViewer.SetText(MakeJSONText("Serializing..."));
+            }
+            jsonShownValid = false;
+        }
+        jsonShown = object;
+        jsonShownRevision = jsonRevision;
+    }
+
+    jsonViewer.Draw("JSON");
 }
 
 void DrawNonEditableTextField(const char* label, const char* format, ...) {
@@ -212,61 +293,92 @@ bool DrawTimeRange(
     return changed;
 }
 
-void DrawMetadataSubtree(std::string key, otio::AnyDictionary& metadata);
+// The metadata table, flattened into rows, so that only the rows in view
+// are drawn. The metadata is walked in place, without copying nested
+// dictionaries out of their anys, and only when the selection, the
+// document or the time display changes.
+struct MetadataRow {
+    std::string key;
+    std::string value;
+    std::string type_name;
+    otio::SerializableObject* selectable = nullptr;
+    int depth = 0;
+    uint32_t descendants = 0;   // rows below a dictionary or array
+    bool container = false;
+    bool open = true;
+};
+static std::vector<MetadataRow> metadataRows;
+// The rows not hidden under a closed dictionary or array
+static std::vector<uint32_t> metadataView;
+static bool metadataViewDirty = true;
 
-void DrawMetadataArray(std::string key, otio::AnyVector& vector);
+// What the rows were built from
+static const otio::AnyDictionary* metadataShown = nullptr;
+static uint64_t metadataShownRevision = 0;
+static int metadataShownTimeFormat = -1;
 
-void DrawMetadataRow(std::string key, otio::any& value) {
-    std::type_info const& type = value.type();
+static void AppendMetadataRow(std::string key, const otio::any& value, int depth);
 
-    if (type == typeid(otio::AnyDictionary)) {
-        auto dict = otio::any_cast<otio::AnyDictionary>(value);
-        DrawMetadataSubtree(key, dict);
-        return;
+static void AppendMetadataRows(const otio::AnyDictionary& metadata, int depth) {
+    for (const auto& pair : metadata) {
+        AppendMetadataRow(pair.first, pair.second, depth);
     }
+}
+
+static void AppendMetadataRow(std::string key, const otio::any& value, int depth) {
+    size_t index = metadataRows.size();
+    metadataRows.emplace_back();
+    metadataRows[index].key = std::move(key);
+    metadataRows[index].depth = depth;
 
-    if (type == typeid(otio::AnyVector)) {
-        auto vector = otio::any_cast<otio::AnyVector>(value);
-        DrawMetadataArray(key, vector);
+    if (const auto& dict = otio::any_cast<otio::AnyDictionary>(&value)) {
+        metadataRows[index].container = true;
+        AppendMetadataRows(*dict, depth + 1);
+        metadataRows[index].descendants = (uint32_t)(metadataRows.size() - index - 1);
         return;
     }
 
-    std::string type_name = "<Unknown>";
-    std::string string_val = "<Unknown>";
+    if (const auto& vector = otio::any_cast<otio::AnyVector>(&value)) {
+        metadataRows[index].container = true;
+        for (size_t i = 0; i < vector->size(); i++) {
+            AppendMetadataRow(Format("[%d]", (int)i), (*vector)[i], depth + 1);
+        }
+        metadataRows[index].descendants = (uint32_t)(metadataRows.size() - index - 1);
+        return;
+    }
 
-    otio::SerializableObject *selectable = nullptr;
+    auto& row = metadataRows[index];
+    row.type_name = "<Unknown>";
+    row.value = "<Unknown>";
 
-    if (type == typeid(std::string)) {
-        type_name = "string";
-        string_val = otio::any_cast<std::string>(value);
+    if (const auto& string = otio::any_cast<std::string>(&value)) {
+        row.type_name = "string";
+        row.value = *string;
     }
-    else if (type == typeid(bool)) {
-        type_name = "bool";
-        string_val = otio::any_cast<bool>(value) ? "true" : "false";
+    else if (const auto& boolean = otio::any_cast<bool>(&value)) {
+        row.type_name = "bool";
+        row.value = *boolean ? "true" : "false";
     }
-    else if (type == typeid(int64_t)) {
-        type_name = "int64_t";
-        string_val = std::to_string(otio::any_cast<int64_t>(value));
+    else if (const auto& integer = otio::any_cast<int64_t>(&value)) {
+        row.type_name = "int64_t";
+        row.value = std::to_string(*integer);
     }
-    else if (type == typeid(double)) {
-        type_name = "double";
-        string_val = std::to_string(otio::any_cast<double>(value));
+    else if (const auto& number = otio::any_cast<double>(&value)) {
+        row.type_name = "double";
+        row.value = std::to_string(*number);
     }
-    else if (type == typeid(otio::RationalTime)) {
-        type_name = "otio::RationalTime";
-        auto time = otio::any_cast<otio::RationalTime>(value);
-        string_val = FormattedStringFromTime(time);
+    else if (const auto& time = otio::any_cast<otio::RationalTime>(&value)) {
+        row.type_name = "otio::RationalTime";
+        row.value = FormattedStringFromTime(*time);
     }
-    else if (type == typeid(otio::SerializableObject::Retainer<otio::SerializableObjectWithMetadata>)) {
-        auto obj = otio::any_cast<otio::SerializableObject::Retainer<otio::SerializableObjectWithMetadata>>(value);
-        type_name = Format("%s.%d", obj->schema_name().c_str(), obj->schema_version());
-        string_val = obj->name();
-        selectable = &*obj;
+    else if (const auto& obj = otio::any_cast<otio::SerializableObject::Retainer<otio::SerializableObjectWithMetadata>>(&value)) {
+        row.type_name = Format("%s.%d", (*obj)->schema_name().c_str(), (*obj)->schema_version());
+        row.value = (*obj)->name();
+        row.selectable = obj->value;
     }
-    else if (type == typeid(otio::SerializableObject::Retainer<otio::SerializableObject>)) {
-        auto obj = otio::any_cast<otio::SerializableObject::Retainer<otio::SerializableObject>>(value);
-        type_name = Format("%s.%d", obj->schema_name().c_str(), obj->schema_version());
-        selectable = &*obj;
+    else if (const auto& obj = otio::any_cast<otio::SerializableObject::Retainer<otio::SerializableObject>>(&value)) {
+        row.type_name = Format("%s.%d", (*obj)->schema_name().c_str(), (*obj)->schema_version());
+        row.selectable = obj->value;
     }
 
     // TODO: Handle these types also?
@@ -277,93 +389,104 @@ void DrawMetadataRow(std::string key, otio::any& value) {
     // Imath::V2d
     // Imath::Box2d
     // SerializableObject::Retainer
+}
 
-    ImGui::TableNextRow();
-    ImGui::TableNextColumn();
-    ImGui::TreeNodeEx(
-        key.c_str(),
-        ImGuiTreeNodeFlags_Leaf |
-            //ImGuiTreeNodeFlags_Bullet |
-            ImGuiTreeNodeFlags_NoTreePushOnOpen
-            | ImGuiTreeNodeFlags_SpanFullWidth | 0);
+static void UpdateMetadataRows(const otio::AnyDictionary& metadata) {
+    int time_format = DisplayTimeFormatFlags() | ((int)appState.drop_frame_mode << 8);
+    if (metadataShown != &metadata
+        || metadataShownRevision != jsonRevision
+        || metadataShownTimeFormat != time_format) {
+        metadataRows.clear();
+        AppendMetadataRows(metadata, 0);
+        metadataShown = &metadata;
+        metadataShownRevision = jsonRevision;
+        metadataShownTimeFormat = time_format;
+        metadataViewDirty = true;
+    }
 
-    ImGui::TableNextColumn();
-    if (selectable != nullptr) {
-        ImGui::PushID(selectable);
-        if (ImGui::Button(string_val.c_str())) {
-            SelectObject(selectable);
+    if (metadataViewDirty) {
+        metadataView.clear();
+        for (uint32_t i = 0; i < metadataRows.size(); i++) {
+            metadataView.push_back(i);
+            if (metadataRows[i].container && !metadataRows[i].open)
+                i += metadataRows[i].descendants;
         }
-        ImGui::PopID();
-    }else{
-        ImGui::TextUnformatted(string_val.c_str());
+        metadataViewDirty = false;
     }
-
-    ImGui::TableNextColumn();
-    ImGui::TextUnformatted(type_name.c_str());
 }
 
-void DrawMetadataRows(otio::AnyDictionary& metadata) {
-    for (auto& pair : metadata) {
-        const auto& key = pair.first;
-        auto& val = pair.second;
+// Returns true if the row was opened or closed
+static bool DrawMetadataRow(uint32_t index) {
+    const auto& row = metadataRows[index];
+    bool toggled = false;
 
-        DrawMetadataRow(key, val);
-    }
-}
-
-void DrawMetadataSubtree(std::string key, otio::AnyDictionary& metadata) {
     ImGui::TableNextRow();
     ImGui::TableNextColumn();
-    bool open = ImGui::TreeNodeEx(
-        key.c_str(),
-        ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_SpanFullWidth);
-
-    ImGui::TableNextColumn();
-    ImGui::TextDisabled("");
-
-    ImGui::TableNextColumn();
-    ImGui::TextDisabled("");
-
-    if (open) {
-        DrawMetadataRows(metadata);
-
-        ImGui::TreePop();
+    ImGui::PushID((int)index);
+    float indent = row.depth * ImGui::GetStyle().IndentSpacing;
+    if (indent > 0)
+        ImGui::Indent(indent);
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen
+        | ImGuiTreeNodeFlags_SpanFullWidth;
+    if (row.container) {
+        ImGui::SetNextItemOpen(row.open);
+        toggled = ImGui::TreeNodeEx(row.key.c_str(), flags) != row.open;
+    } else {
+        ImGui::TreeNodeEx(row.key.c_str(), flags | ImGuiTreeNodeFlags_Leaf);
     }
-}
-
-void DrawMetadataArray(std::string key, otio::AnyVector& vector) {
-    ImGui::TableNextRow();
-    ImGui::TableNextColumn();
-    bool open = ImGui::TreeNodeEx(
-        key.c_str(),
-        ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_SpanFullWidth);
+    if (indent > 0)
+        ImGui::Unindent(indent);
 
     ImGui::TableNextColumn();
-    ImGui::TextDisabled("");
-
-    ImGui::TableNextColumn();
-    ImGui::TextDisabled("");
-
-    if (open) {
-        for (int i = 0; i < vector.size(); i++) {
-            DrawMetadataRow(Format("[%d]", i), vector[i]);
+    if (row.container) {
+        ImGui::TextDisabled("");
+    } else if (row.selectable != nullptr) {
+        if (ImGui::Button(row.value.c_str())) {
+            SelectObject(row.selectable);
         }
+    } else {
+        ImGui::TextUnformatted(row.value.c_str());
+    }
 
-        ImGui::TreePop();
+    ImGui::TableNextColumn();
+    if (row.container) {
+        ImGui::TextDisabled("");
+    } else {
+        ImGui::TextUnformatted(row.type_name.c_str());
     }
+    ImGui::PopID();
+    return toggled;
 }
+
 void DrawMetadataTable(otio::AnyDictionary& metadata) {
     static ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH
         | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg
         | ImGuiTableFlags_NoBordersInBody | ImGuiTableFlags_Hideable;
 
+    UpdateMetadataRows(metadata);
+
     if (ImGui::BeginTable("Metadata", 3, flags)) {
         ImGui::TableSetupColumn("Key", ImGuiTableColumnFlags_NoHide);
         ImGui::TableSetupColumn("Value");
         ImGui::TableSetupColumn("Type");
         ImGui::TableHeadersRow();
 
-        DrawMetadataRows(metadata);
+        // opening or closing changes the rows, so wait until they are all drawn
+        int64_t toggle_row = -1;
+        ImGuiListClipper clipper;
+        clipper.Begin((int)metadataView.size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                if (DrawMetadataRow(metadataView[i]))
+                    toggle_row = metadataView[i];
+            }
+        }
+        clipper.End();
+
+        if (toggle_row >= 0) {
+            metadataRows[toggle_row].open = !metadataRows[toggle_row].open;
+            metadataViewDirty = true;
+        }
 
         ImGui::EndTable();
     }
@@ -488,7 +611,7 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
             selected_object.value)) {
         snprintf(tmp_str, sizeof(tmp_str), "%s", obj->name().c_str());
         if (ImGui::InputText("Name", tmp_str, sizeof(tmp_str))) {
-            obj->set_name(tmp_str);
+            EditName(obj, tmp_str);
         }
     }
 
@@ -507,8 +630,7 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
         auto global_start_time = timeline->global_start_time().value_or(otio::RationalTime(0, rate));
         // don't allow negative duration - but 0 is okay
         if (DrawRationalTime(tp, "Global Start", &global_start_time, true)) {
-            timeline->set_global_start_time(global_start_time);
-            DetectPlayheadLimits();
+            EditGlobalStart(timeline, global_start_time);
         }
     }
 
@@ -520,13 +642,13 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
             auto item_color = GetItemColor(item);
             item_color = DrawColorChooser(item_color);
             if (item_color != "") {
-                SetItemColor(item, item_color);
+                EditItemColor(item, item_color);
             }
         }
 
         auto trimmed_range = item->trimmed_range();
         if (DrawTimeRange("Trimmed Range", &trimmed_range, true)) {
-            item->set_source_range(trimmed_range);
+            EditSourceRange(item, trimmed_range);
         }
         // Grab the effects list so we can display it later
         effects = item->effects();
@@ -541,12 +663,12 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
     if (const auto& transition = dynamic_cast<otio::Transition*>(selected_object.value)) {
         auto in_offset = transition->in_offset();
         if (DrawRationalTime(tp, "In Offset", &in_offset, false)) {
-            transition->set_in_offset(in_offset);
+            EditInOffset(transition, in_offset);
         }
 
         auto out_offset = transition->out_offset();
         if (DrawRationalTime(tp, "Out Offset", &out_offset, false)) {
-            transition->set_out_offset(out_offset);
+            EditOutOffset(transition, out_offset);
         }
 
         DrawNonEditableTextField(
@@ -569,7 +691,7 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
         if (const auto& timewarp = dynamic_cast<otio::LinearTimeWarp*>(effect.value)) {
             float val = timewarp->time_scalar();
             if (ImGui::DragFloat("Time Scale", &val, 0.01, -FLT_MAX, FLT_MAX)) {
-                timewarp->set_time_scalar(val);
+                EditTimeScalar(timewarp, val);
             }
             if (const auto& item = dynamic_cast<otio::Item*>(effect_context)) {
                 DrawLinearTimeWarp(timewarp, item);
@@ -583,7 +705,7 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
 
         auto color_name = DrawColorChooser(marker->color());
         if (color_name != "") {
-            marker->set_color(color_name);
+            EditMarkerColor(marker, color_name);
         }
 
         ImGui::SameLine();
@@ -593,7 +715,7 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
 
         auto marked_range = marker->marked_range();
         if (DrawTimeRange("Marked Range", &marked_range, false)) {
-            marker->set_marked_range(marked_range);
+            EditMarkedRange(marker, marked_range);
         }
     }
 
@@ -613,6 +735,192 @@ void raven::DrawInspector(TimelineProviderHarness* tp) {
     }
 }
 
+// Formatted times for the rows of the Markers inspector. They are filled
+// in as rows scroll into view, and dropped whenever the markers change.
+struct MarkerRowStrings {
+    bool valid = false;
+    std::string local_time;
+    std::string global_time;
+    std::string duration;
+};
+static std::vector<MarkerRowStrings> markerRowStrings;
+static uint64_t markerRowRevision = 0;
+static opentime::IsDropFrameRate markerRowDropFrameMode = opentime::InferFromRate;
+static otio::RationalTime markerRowGlobalStart;  // added to the global times
+
+enum MarkerColumn {
+    MarkerColumn_LocalTime,
+    MarkerColumn_GlobalTime,
+    MarkerColumn_Duration,
+    MarkerColumn_Color,
+    MarkerColumn_Name,
+    MarkerColumn_Item
+};
+
+// Sort keys for the Markers inspector, parallel to MarkersByTime, so that
+// sorting compares numbers instead of strings or times. Each kind of key
+// is computed the first time a sort needs it, and all of them are
+// dropped when the markers change. Global time needs no key, since the
+// position in MarkersByTime is already in that order.
+struct MarkerSortKeys {
+    std::vector<double> local_times;
+    std::vector<double> durations;
+    std::vector<uint32_t> color_ranks;
+    std::vector<uint32_t> name_ranks;
+    std::vector<uint32_t> item_ranks;
+};
+static MarkerSortKeys markerSortKeys;
+
+// The rows shown, as indices into MarkersByTime, after filtering and sorting
+static std::vector<uint32_t> markerView;
+static bool markerViewDirty = true;
+static std::vector<ImGuiTableColumnSortSpecs> markerSortSpecs;
+static ImGuiTextFilter markerFilter;
+
+// Colors aren't in the provider, so its marker revision doesn't cover them
+void raven::MarkerColorChanged() {
+    markerSortKeys.color_ranks.clear();
+    markerViewDirty = true;
+}
+
+static otio::Marker* MarkerAt(OTIOProvider* op, size_t index) {
+    return dynamic_cast<otio::Marker*>(op->OtioFromNode(op->MarkersByTime()[index]).value);
+}
+
+// Rank strings so that equal strings share a rank, ignoring case
+template<typename NameFn>
+static std::vector<uint32_t> RankStrings(size_t count, NameFn name) {
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; i++)
+        order[i] = (uint32_t)i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return ImStricmp(name(a), name(b)) < 0;
+    });
+    std::vector<uint32_t> ranks(count);
+    uint32_t rank = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && ImStricmp(name(order[i - 1]), name(order[i])) != 0)
+            rank++;
+        ranks[order[i]] = rank;
+    }
+    return ranks;
+}
+
+static void BuildMarkerSortKey(OTIOProvider* op, ImGuiID column) {
+    const auto& markers = op->MarkersByTime();
+    size_t count = markers.size();
+    auto& keys = markerSortKeys;
+    switch (column) {
+    case MarkerColumn_LocalTime:
+    case MarkerColumn_Duration:
+        if (keys.local_times.size() == count)
+            return;
+        keys.local_times.resize(count);
+        keys.durations.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            auto range = MarkerAt(op, i)->marked_range();
+            keys.local_times[i] = range.start_time().to_seconds();
+            keys.durations[i] = range.duration().to_seconds();
+        }
+        break;
+    case MarkerColumn_Color:
+        if (keys.color_ranks.size() == count)
+            return;
+        keys.color_ranks.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            // in the order of the color menu, with unknown colors last
+            const auto& color = MarkerAt(op, i)->color();
+            uint32_t rank = 0;
+            while (rank < IM_ARRAYSIZE(marker_color_names)
+                   && color != marker_color_names[rank])
+                rank++;
+            keys.color_ranks[i] = rank;
+        }
+        break;
+    case MarkerColumn_Name:
+        if (keys.name_ranks.size() == count)
+            return;
+        keys.name_ranks = RankStrings(count, [&](uint32_t i) {
+            return op->Name(markers[i]).data();
+        });
+        break;
+    case MarkerColumn_Item:
+        if (keys.item_ranks.size() == count)
+            return;
+        keys.item_ranks = RankStrings(count, [&](uint32_t i) {
+            return op->Name(op->HasParent(markers[i])).data();
+        });
+        break;
+    }
+}
+
+// Compare two markers by one column. Global time is the position itself.
+static int CompareMarkers(ImGuiID column, uint32_t a, uint32_t b) {
+    const auto& keys = markerSortKeys;
+    auto compare = [](auto x, auto y) { return x < y ? -1 : (y < x ? 1 : 0); };
+    switch (column) {
+    case MarkerColumn_LocalTime:
+        return compare(keys.local_times[a], keys.local_times[b]);
+    case MarkerColumn_Duration:
+        return compare(keys.durations[a], keys.durations[b]);
+    case MarkerColumn_Color:
+        return compare(keys.color_ranks[a], keys.color_ranks[b]);
+    case MarkerColumn_Name:
+        return compare(keys.name_ranks[a], keys.name_ranks[b]);
+    case MarkerColumn_Item:
+        return compare(keys.item_ranks[a], keys.item_ranks[b]);
+    }
+    return compare(a, b);
+}
+
+static void BuildMarkerView(OTIOProvider* op) {
+    const auto& markers = op->MarkersByTime();
+    markerView.clear();
+    markerView.reserve(markers.size());
+    for (size_t i = 0; i < markers.size(); i++) {
+        if (markerFilter.IsActive()) {
+            TimelineNode markerNode = markers[i];
+            if (!markerFilter.PassFilter(op->Name(markerNode).data())
+                && !markerFilter.PassFilter(op->Name(op->HasParent(markerNode)).data())
+                && !markerFilter.PassFilter(MarkerAt(op, i)->color().c_str()))
+                continue;
+        }
+        markerView.push_back((uint32_t)i);
+    }
+
+    for (const auto& spec : markerSortSpecs) {
+        BuildMarkerSortKey(op, spec.ColumnUserID);
+    }
+    if (!markerSortSpecs.empty()) {
+        std::sort(markerView.begin(), markerView.end(), [](uint32_t a, uint32_t b) {
+            for (const auto& spec : markerSortSpecs) {
+                int delta = CompareMarkers(spec.ColumnUserID, a, b);
+                if (delta != 0) {
+                    return spec.SortDirection == ImGuiSortDirection_Ascending ? delta < 0 : delta > 0;
+                }
+            }
+            // ties stay in time order
+            return a < b;
+        });
+    }
+    markerViewDirty = false;
+}
+
+static const MarkerRowStrings& MarkerRowStringsFor(OTIOProvider* op, size_t index) {
+    auto& strings = markerRowStrings[index];
+    if (strings.valid)
+        return strings;
+
+    TimelineNode markerNode = op->MarkersByTime()[index];
+    auto marker = MarkerAt(op, index);
+    auto range = marker->marked_range();
+    strings.local_time = TimecodeStringFromTime(range.start_time());
+    strings.global_time = TimecodeStringFromTime(op->StartTime(markerNode) + markerRowGlobalStart);
+    strings.duration = TimecodeStringFromTime(range.duration());
+    strings.valid = true;
+    return strings;
+}
+
 void raven::DrawMarkersInspector(TimelineProviderHarness* tp) {
     OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
     if (op->RootNode() == TimelineNodeNull()) {
@@ -622,111 +930,121 @@ void raven::DrawMarkersInspector(TimelineProviderHarness* tp) {
         return;
     }
 
-    // This temporary variable is used only for a moment to convert
-    // between the datatypes that OTIO uses vs the one that ImGui widget uses.
-    char tmp_str[1000];
-
-    struct marker_parent_pair {
-        otio::SerializableObject::Retainer<otio::Marker> marker;
-        otio::SerializableObject::Retainer<otio::Item> parent;
-        TimelineNode markerNode;
-        TimelineNode parentNode;
-    };
-    
-    std::vector<marker_parent_pair> pairs;
-    otio::Timeline* timeline = op->OtioTimeline();
-    auto root = timeline->tracks();
-    auto global_start = timeline->global_start_time().value_or(otio::RationalTime());
-
-    TimelineNode rootNode = op->NodeFromOtio(root);
-    for (const auto& marker : root->markers()) {
-        TimelineNode markerNode = op->NodeFromOtio(marker);
-        pairs.push_back((marker_parent_pair) {marker, root, markerNode, rootNode});
+    // The provider keeps the markers sorted as the document is edited, so
+    // only the rows on screen are looked at here.
+    const auto& markers = op->MarkersByTime();
+    auto global_start = op->OtioTimeline()->global_start_time().value_or(otio::RationalTime());
+    if (markerRowRevision != op->MarkerRevision()
+        || markerRowDropFrameMode != appState.drop_frame_mode
+        || markerRowGlobalStart.value() != global_start.value()
+        || markerRowGlobalStart.rate() != global_start.rate()) {
+        markerRowStrings.clear();
+        markerRowStrings.resize(markers.size());
+        markerRowRevision = op->MarkerRevision();
+        markerRowDropFrameMode = appState.drop_frame_mode;
+        markerRowGlobalStart = global_start;
+        markerSortKeys = MarkerSortKeys();
+        markerViewDirty = true;
     }
 
-    for (const auto& child : timeline->tracks()->find_children())
-    {
-        if (const auto& item = dynamic_cast<otio::Item*>(&*child))
-        {
-            TimelineNode itemNode = op->NodeFromOtio(item);
-            for (const auto& marker : item->markers()) {
-                TimelineNode markerNode = op->NodeFromOtio(marker);
-                pairs.push_back((marker_parent_pair) {marker, item, markerNode, itemNode});
-            }
-        }
+    if (markerFilter.Draw("Filter")) {
+        markerViewDirty = true;
     }
 
     auto selectable_flags = ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowItemOverlap;
 
     if (ImGui::BeginTable("Markers",
-                          5,
-//                          ImGuiTableFlags_Sortable |
+                          6,
+                          ImGuiTableFlags_Sortable |
+                          ImGuiTableFlags_SortMulti |
                           ImGuiTableFlags_NoSavedSettings |
                           ImGuiTableFlags_Resizable |
                           ImGuiTableFlags_Reorderable |
-                          ImGuiTableFlags_Hideable))
+                          ImGuiTableFlags_Hideable |
+                          ImGuiTableFlags_ScrollY))
     {
-        ImGui::TableSetupColumn("Local Time", ImGuiTableColumnFlags_DefaultHide | ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn("Global Time", ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn("Duration", ImGuiTableColumnFlags_DefaultHide | ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
-        ImGui::TableSetupColumn("Item", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Local Time", ImGuiTableColumnFlags_DefaultHide | ImGuiTableColumnFlags_WidthFixed, 0, MarkerColumn_LocalTime);
+        ImGui::TableSetupColumn("Global Time", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_WidthFixed, 0, MarkerColumn_GlobalTime);
+        ImGui::TableSetupColumn("Duration", ImGuiTableColumnFlags_DefaultHide | ImGuiTableColumnFlags_WidthFixed, 0, MarkerColumn_Duration);
+        ImGui::TableSetupColumn("Color", ImGuiTableColumnFlags_WidthFixed, 0, MarkerColumn_Color);
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch, 0, MarkerColumn_Name);
+        ImGui::TableSetupColumn("Item", ImGuiTableColumnFlags_WidthStretch, 0, MarkerColumn_Item);
 
         ImGui::TableHeadersRow();
 
-        for (const marker_parent_pair& pair : pairs)
-        {
-            auto& marker = pair.marker;
-            auto& parent = pair.parent;
+        if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs()) {
+            if (sort_specs->SpecsDirty) {
+                markerSortSpecs.assign(sort_specs->Specs, sort_specs->Specs + sort_specs->SpecsCount);
+                sort_specs->SpecsDirty = false;
+                markerViewDirty = true;
+            }
+        }
+        if (markerViewDirty) {
+            BuildMarkerView(op);
+        }
 
-            ImGui::PushID(&pair.markerNode);
-            ImGui::TableNextRow();
+        ImGuiListClipper clipper;
+        clipper.Begin((int)markerView.size());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                uint32_t index = markerView[row];
+                TimelineNode markerNode = markers[index];
+                TimelineNode parentNode = op->HasParent(markerNode);
+                auto marker = MarkerAt(op, index);
+                const auto& strings = MarkerRowStringsFor(op, index);
 
-            // Local Time
-            ImGui::TableNextColumn();
+                ImGui::PushID((int) op->StationaryId(markerNode));
+                ImGui::TableNextRow();
 
-            auto range = marker->marked_range();
-            ImGui::TextUnformatted(TimecodeStringFromTime(range.start_time()).c_str());
+                // Local Time
+                ImGui::TableNextColumn();
 
-            // Global Time
-            ImGui::TableNextColumn();
+                ImGui::TextUnformatted(strings.local_time.c_str());
 
-            auto global_time = parent->transformed_time(range.start_time(), root) + global_start;
+                // Global Time
+                ImGui::TableNextColumn();
 
-            auto is_selected =
-                (tp->selected_object == pair.markerNode) ||
-                (tp->selected_object == pair.parentNode);
-            if (ImGui::Selectable(TimecodeStringFromTime(global_time).c_str(),
-                                  is_selected,
-                                  selectable_flags)) {
-                tp->playhead = global_time;
-                SelectObject(marker, parent);
-                appState.timelinePH.scroll_to_playhead = true;
-            }
+                auto is_selected =
+                    (tp->selected_object == markerNode) ||
+                    (tp->selected_object == parentNode);
+                if (ImGui::Selectable(strings.global_time.c_str(),
+                                      is_selected,
+                                      selectable_flags)) {
+                    auto global_start = op->OtioTimeline()->global_start_time().value_or(otio::RationalTime());
+                    tp->playhead = op->StartTime(markerNode) + global_start;
+                    SelectObject(marker, op->OtioFromNode(parentNode));
+                    appState.timelinePH.scroll_to_playhead = true;
+                }
 
-            // Duration
-            ImGui::TableNextColumn();
+                // Duration
+                ImGui::TableNextColumn();
 
-            auto duration = range.duration();
-            ImGui::TextUnformatted(TimecodeStringFromTime(duration).c_str());
+                ImGui::TextUnformatted(strings.duration.c_str());
 
-            // Color + Name
-            ImGui::TableNextColumn();
+                // Color
+                ImGui::TableNextColumn();
 
-            ImGui::PushStyleColor(ImGuiCol_Text, UIColorFromName(marker->color()));
-            ImGui::TextUnformatted("\xef\x80\xab");
-            ImGui::PopStyleColor();
-            ImGui::SameLine();
+                ImGui::PushStyleColor(ImGuiCol_Text, UIColorFromName(marker->color()));
+                ImGui::TextUnformatted("\xef\x80\xab");
+                ImGui::PopStyleColor();
 
-            ImGui::TextUnformatted(marker->name().c_str());
+                // Name
+                ImGui::TableNextColumn();
 
-            // Item
-            ImGui::TableNextColumn();
+                auto name = op->Name(markerNode);
+                ImGui::TextUnformatted(name.data(), name.data() + name.size());
 
-            ImGui::TextUnformatted(parent->name().c_str());
+                // Item
+                ImGui::TableNextColumn();
 
-            ImGui::PopID();
+                auto item_name = op->Name(parentNode);
+                ImGui::TextUnformatted(item_name.data(), item_name.data() + item_name.size());
+
+                ImGui::PopID();
+            }
         }
+        clipper.End();
+        ImGui::EndTable();
     }
-    ImGui::EndTable();
 }
@@ -5,4 +5,6 @@ class TimelineProviderHarness;
 void DrawInspector(TimelineProviderHarness*);
 void DrawJSONInspector();
 void DrawMarkersInspector(TimelineProviderHarness*);
+// Call after changing a marker's color
+void MarkerColorChanged();
 }
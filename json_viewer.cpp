@@ -0,0 +1,277 @@
+// Read-only JSON viewer
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include "json_viewer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace raven;
+
+// Same scheme as the ImGuiColorTextEdit dark palette we used to draw with
+static const ImU32 json_key_color = IM_COL32(0x9c, 0xdc, 0xfe, 0xff);
+static const ImU32 json_string_color = IM_COL32(0xe0, 0x70, 0x70, 0xff);
+static const ImU32 json_number_color = IM_COL32(0x00, 0xff, 0x00, 0xff);
+static const ImU32 json_keyword_color = IM_COL32(0x56, 0x9c, 0xd6, 0xff);
+
+const char* JSONText::LineBegin(size_t line) const {
+    return text.data() + line_starts[line];
+}
+
+const char* JSONText::LineEnd(size_t line) const {
+    size_t end = line + 1 < line_starts.size() ? line_starts[line + 1] - 1 : text.size();
+    if (end > line_starts[line] && text[end - 1] == '\r')
+        end--;
+    return text.data() + end;
+}
+
+size_t JSONText::MemoryUsage() const {
+    return text.capacity()
+        + line_starts.capacity() * sizeof(size_t)
+        + fold_ends.capacity() * sizeof(uint32_t);
+}
+
+std::shared_ptr<const JSONText> raven::MakeJSONText(std::string&& text) {
+    auto result = std::make_shared<JSONText>();
+    result->text = std::move(text);
+    const std::string& s = result->text;
+
+    // One pass over the text, matching brackets outside of strings
+    std::vector<uint32_t> open;
+    uint32_t line = 0;
+    bool in_string = false;
+    bool escaped = false;
+    result->line_starts.push_back(0);
+    result->fold_ends.push_back(0);
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (in_string) {
+            if (escaped)
+                escaped = false;
+            else if (c == '\\')
+                escaped = true;
+            else if (c == '"')
+                in_string = false;
+            continue;
+        }
+        switch (c) {
+        case '"':
+            in_string = true;
+            break;
+        case '\n':
+            if (i + 1 == s.size())
+                break;
+            line++;
+            result->line_starts.push_back(i + 1);
+            result->fold_ends.push_back(line);
+            break;
+        case '{':
+        case '[':
+            open.push_back(line);
+            break;
+        case '}':
+        case ']':
+            if (!open.empty()) {
+                // an outer bracket on the same line closes later, and wins
+                uint32_t opened = open.back();
+                open.pop_back();
+                if (line > opened)
+                    result->fold_ends[opened] = line;
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+void JSONViewer::SetText(std::shared_ptr<const JSONText> text) {
+    _text = text;
+    _collapsed.clear();
+    _rows.clear();
+}
+
+void JSONViewer::Toggle(uint32_t line) {
+    if (_collapsed.empty())
+        _collapsed.resize(_text->LineCount(), 0);
+    _collapsed[line] = !_collapsed[line];
+    RebuildRows();
+}
+
+void JSONViewer::CollapseAll(bool collapse) {
+    if (!collapse) {
+        _collapsed.clear();
+        _rows.clear();
+        return;
+    }
+    // keep the outermost object open, so its immediate children show
+    _collapsed.assign(_text->LineCount(), 1);
+    if (!_collapsed.empty())
+        _collapsed[0] = 0;
+    RebuildRows();
+}
+
+void JSONViewer::RebuildRows() {
+    _rows.clear();
+    if (_collapsed.empty())
+        return;
+    bool any = false;
+    uint32_t count = (uint32_t)_text->LineCount();
+    for (uint32_t line = 0; line < count; line++) {
+        _rows.push_back(line);
+        if (_collapsed[line] && _text->fold_ends[line] > line) {
+            line = _text->fold_ends[line];
+            any = true;
+        }
+    }
+    if (!any) {
+        _collapsed.clear();
+        _rows.clear();
+    }
+}
+
+// Draw one run of text and advance the pen
+static void DrawRun(ImDrawList* draw_list, ImVec2* pos, ImU32 color, const char* begin, const char* end) {
+    if (begin == end)
+        return;
+    draw_list->AddText(*pos, color, begin, end);
+    pos->x += ImGui::CalcTextSize(begin, end).x;
+}
+
+// Color a single line of JSON. Strings never span lines in serialized
+// JSON, so each line can be tokenized on its own.
+static void DrawTokens(ImDrawList* draw_list, ImVec2 pos, const char* p, const char* end) {
+    ImU32 text_color = ImGui::GetColorU32(ImGuiCol_Text);
+    while (p < end) {
+        const char* start = p;
+        char c = *p;
+        ImU32 color = text_color;
+        if (c == '"') {
+            p++;
+            while (p < end && *p != '"') {
+                if (*p == '\\' && p + 1 < end)
+                    p++;
+                p++;
+            }
+            if (p < end)
+                p++;
+            const char* next = p;
+            while (next < end && *next == ' ')
+                next++;
+            color = (next < end && *next == ':') ? json_key_color : json_string_color;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            while (p < end && (strchr("+-.eE", *p) || (*p >= '0' && *p <= '9')))
+                p++;
+            color = json_number_color;
+        } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            while (p < end && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')))
+                p++;
+            color = json_keyword_color;
+        } else {
+            while (p < end && *p != '"' && *p != '-' && !(*p >= '0' && *p <= '9')
+                   && !((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')))
+                p++;
+        }
+        DrawRun(draw_list, &pos, color, start, p);
+    }
+}
+
+// Returns true if the fold arrow of this line was clicked
+bool JSONViewer::DrawLine(uint32_t line, float gutter_width, int digits) {
+    auto draw_list = ImGui::GetWindowDrawList();
+    float line_height = ImGui::GetTextLineHeight();
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImU32 dim_color = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+
+    char number[32];
+    snprintf(number, sizeof(number), "%*u", digits, line + 1);
+    draw_list->AddText(pos, dim_color, number);
+
+    uint32_t fold_end = _text->fold_ends[line];
+    bool collapsed = !_collapsed.empty() && _collapsed[line] && fold_end > line;
+    bool clicked = false;
+    if (fold_end > line) {
+        ImVec2 arrow_pos(pos.x + gutter_width - line_height, pos.y);
+        ImGui::RenderArrow(
+            draw_list,
+            arrow_pos + ImVec2(line_height * 0.15f, line_height * 0.15f),
+            dim_color,
+            collapsed ? ImGuiDir_Right : ImGuiDir_Down,
+            0.7f);
+        ImRect arrow_rect(arrow_pos, arrow_pos + ImVec2(line_height, line_height));
+        if (ImGui::IsWindowHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)
+            && arrow_rect.Contains(ImGui::GetIO().MousePos)) {
+            clicked = true;
+        }
+    }
+
+    ImVec2 text_pos(pos.x + gutter_width, pos.y);
+    const char* begin = _text->LineBegin(line);
+    const char* end = _text->LineEnd(line);
+    DrawTokens(draw_list, text_pos, begin, end);
+    float width = gutter_width + ImGui::CalcTextSize(begin, end).x;
+
+    if (collapsed) {
+        // show the closing bracket, without its indentation
+        const char* close = _text->LineBegin(fold_end);
+        const char* close_end = _text->LineEnd(fold_end);
+        while (close < close_end && *close == ' ')
+            close++;
+        ImVec2 tail_pos(pos.x + width, pos.y);
+        DrawRun(draw_list, &tail_pos, dim_color, " ... ", nullptr);
+        DrawTokens(draw_list, tail_pos, close, close_end);
+        width = tail_pos.x - pos.x + ImGui::CalcTextSize(close, close_end).x;
+    }
+
+    // reserve the space, so the clipper and the scrollbars know about it
+    ImGui::Dummy(ImVec2(width, line_height));
+    return clicked;
+}
+
+void JSONViewer::Draw(const char* str_id) {
+    ImGui::BeginChild(str_id, ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+    if (_text) {
+        uint32_t line_count = (uint32_t)_text->LineCount();
+        int digits = 1;
+        for (uint32_t n = line_count; n >= 10; n /= 10)
+            digits++;
+        float line_height = ImGui::GetTextLineHeight();
+        float gutter_width = ImGui::CalcTextSize("0").x * (digits + 1) + line_height;
+
+        ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
+        // folding changes the rows, so wait until they are all drawn
+        int64_t toggle_line = -1;
+        ImGuiListClipper clipper;
+        clipper.Begin(_rows.empty() ? (int)line_count : (int)_rows.size());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                uint32_t line = _rows.empty() ? (uint32_t)row : _rows[row];
+                if (DrawLine(line, gutter_width, digits)) {
+                    toggle_line = line;
+                }
+            }
+        }
+        clipper.End();
+        ImGui::PopStyleVar();
+        if (toggle_line >= 0) {
+            Toggle((uint32_t)toggle_line);
+        }
+
+        if (ImGui::BeginPopupContextWindow()) {
+            if (ImGui::MenuItem("Collapse All")) {
+                CollapseAll(true);
+            }
+            if (ImGui::MenuItem("Expand All")) {
+                CollapseAll(false);
+            }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Copy All")) {
+                ImGui::SetClipboardText(_text->text.c_str());
+            }
+            ImGui::EndPopup();
+        }
+    }
+    ImGui::EndChild();
+}
@@ -0,0 +1,49 @@
+// Read-only JSON viewer
+#ifndef RAVEN_JSON_VIEWER_H
+#define RAVEN_JSON_VIEWER_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace raven {
+
+// Serialized JSON plus an index of where each line starts, so that it can
+// be drawn a few lines at a time. Built once, then shared read-only.
+struct JSONText {
+    std::string text;
+    std::vector<size_t> line_starts;
+    // For a line that opens an object or array which closes on a later
+    // line, the line that closes it. Otherwise the line itself.
+    std::vector<uint32_t> fold_ends;
+
+    size_t LineCount() const { return line_starts.size(); }
+    const char* LineBegin(size_t line) const;
+    const char* LineEnd(size_t line) const;
+    size_t MemoryUsage() const;
+};
+
+std::shared_ptr<const JSONText> MakeJSONText(std::string&& text);
+
+// Draws only the lines that are on screen, coloring them as it goes, and
+// lets the user collapse and expand objects and arrays.
+class JSONViewer {
+public:
+    void SetText(std::shared_ptr<const JSONText> text);
+    void Draw(const char* str_id);
+
+private:
+    void Toggle(uint32_t line);
+    void CollapseAll(bool collapse);
+    void RebuildRows();
+    bool DrawLine(uint32_t line, float gutter_width, int digits);
+
+    std::shared_ptr<const JSONText> _text;
+    std::vector<uint8_t> _collapsed;  // per line, empty until something is collapsed
+    std::vector<uint32_t> _rows;      // visible lines, empty when nothing is collapsed
+};
+
+} // raven
+
+#endif
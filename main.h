@@ -3,3 +3,7 @@ void MainInit(int argc, char** argv, int initial_width, int initial_height);
 void MainGui();
 void MainCleanup();
 
+// Provided by each platform's main. Makes an RGBA texture that repeats when
+// sampled outside 0..1, for use with ImDrawList::AddImage. Returns NULL
+// where the renderer backend can't sample with wrapping.
+ImTextureID CreateRepeatingTexture(int width, int height, const unsigned char* rgba_pixels);
@@ -16,6 +16,7 @@
 #include <SDL_opengles2.h>
 
 #include "main.h"
+#include "memory_tracker.h"
 
 // Emscripten requires to have full control over the main loop. We're going to store our SDL book-keeping variables globally.
 // Having a single function that acts as a loop prevents us to store state in the stack of said function. So we need some location for this.
@@ -25,6 +26,20 @@ SDL_GLContext   g_GLContext = NULL;
 // For clarity, our main loop code is declared at the end.
 static void main_loop(void*);
 
+ImTextureID CreateRepeatingTexture(int width, int height, const unsigned char* rgba_pixels)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba_pixels);
+    return (ImTextureID)(intptr_t)texture;
+}
+
 int main(int argc, char** argv)
 {
     // Setup SDL
@@ -70,6 +85,7 @@ int main(int argc, char** argv)
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    raven::InstallMemoryTracking();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;       // Enable Keyboard Controls
@@ -9,6 +9,7 @@
 #include <stdio.h>
 
 #include "main.h"
+#include "memory_tracker.h"
 
 #define GLFW_INCLUDE_NONE
 #define GLFW_EXPOSE_NATIVE_COCOA
@@ -23,10 +24,18 @@ static void glfw_error_callback(int error, const char* description)
     fprintf(stderr, "Glfw Error %d: %s\n", error, description);
 }
 
+// The Metal backend samples with clamp to edge, so a texture can't be
+// tiled across a quad; callers fall back to drawing without one.
+ImTextureID CreateRepeatingTexture(int width, int height, const unsigned char* rgba_pixels)
+{
+    return NULL;
+}
+
 int main(int argc, char** argv)
 {
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    raven::InstallMemoryTracking();
     ImGui::CreateContext();
     ImPlot::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
@@ -9,6 +9,7 @@
 #include <tchar.h>
 
 #include "main.h"
+#include "memory_tracker.h"
 
 // Data
 static ID3D11Device*            g_pd3dDevice = NULL;
@@ -42,6 +43,44 @@ void CALLBACK MessageFiberProc(LPVOID lpFiberParameter)
     }
 }
 
+// The DX11 backend samples every texture with wrapping, so nothing special
+// is needed here beyond making the texture.
+ImTextureID CreateRepeatingTexture(int width, int height, const unsigned char* rgba_pixels)
+{
+    D3D11_TEXTURE2D_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+    desc.Width = width;
+    desc.Height = height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    D3D11_SUBRESOURCE_DATA subResource;
+    subResource.pSysMem = rgba_pixels;
+    subResource.SysMemPitch = desc.Width * 4;
+    subResource.SysMemSlicePitch = 0;
+
+    ID3D11Texture2D* texture = NULL;
+    if (g_pd3dDevice->CreateTexture2D(&desc, &subResource, &texture) != S_OK)
+        return NULL;
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    ZeroMemory(&srvDesc, sizeof(srvDesc));
+    srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels = desc.MipLevels;
+    srvDesc.Texture2D.MostDetailedMip = 0;
+    ID3D11ShaderResourceView* view = NULL;
+    HRESULT hr = g_pd3dDevice->CreateShaderResourceView(texture, &srvDesc, &view);
+    texture->Release();
+    if (hr != S_OK)
+        return NULL;
+    return (ImTextureID)view;
+}
+
 // Main code
 int main(int argc, char** argv)
 {
@@ -83,6 +122,7 @@ int main(int argc, char** argv)
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    raven::InstallMemoryTracking();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;       // Enable Keyboard Controls
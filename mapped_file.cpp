@@ -0,0 +1,109 @@
+// Read-only memory mapped files
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace raven {
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+    HANDLE file = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    _file = file;
+    _size = (size_t)size.QuadPart;
+    if (_size == 0) {
+        // empty files can't be mapped, but there's nothing to read anyway
+        return true;
+    }
+    _mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (_mapping != NULL)
+        _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (_data == nullptr) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle((HANDLE)_mapping);
+    if (_file)
+        CloseHandle((HANDLE)_file);
+    _data = nullptr;
+    _mapping = nullptr;
+    _file = nullptr;
+    _size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    _size = (size_t)info.st_size;
+    if (_size == 0) {
+        // empty files can't be mapped, but there's nothing to read anyway
+        close(fd);
+        return true;
+    }
+    void* data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file open
+    close(fd);
+    if (data == MAP_FAILED) {
+        _size = 0;
+        return false;
+    }
+    _data = (const char*)data;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (_data)
+        munmap((void*)_data, _size);
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
+
+} // raven
@@ -0,0 +1,38 @@
+// Read-only memory mapped files
+#ifndef RAVEN_MAPPED_FILE_H
+#define RAVEN_MAPPED_FILE_H
+
+#include <stddef.h>
+#include <string>
+
+namespace raven {
+
+// A whole file mapped into memory for reading. The pages are only read
+// from disk as they are touched, so opening even a very large file is
+// cheap. The data stays valid until the MappedFile is closed or destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
+
+} // raven
+
+#endif
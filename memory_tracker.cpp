@@ -0,0 +1,369 @@
+// Memory tracking
+
+#include "imgui.h"
+
+#include "memory_tracker.h"
+#include "app.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace raven {
+
+static const char* memory_tag_names[MemoryTag_COUNT] = {
+    "Other",
+    "Document",
+    "Provider",
+    "Inspector",
+    "JSON",
+    "Renderer",
+};
+
+const char* MemoryTagName(MemoryTag tag) {
+    if (tag < 0 || tag >= MemoryTag_COUNT)
+        return "?";
+    return memory_tag_names[tag];
+}
+
+#ifdef RAVEN_MEMORY_TRACKING
+
+// Counted from inside operator new, so these are all plain atomics with
+// constant initialization, ready before any constructor runs.
+struct MemoryCounters {
+    std::atomic<int64_t> live_bytes;
+    std::atomic<int64_t> peak_bytes;
+    std::atomic<int64_t> live_allocations;
+    std::atomic<int64_t> total_allocations;
+};
+
+static MemoryCounters memory_counters[MemoryTag_COUNT];
+static MemoryCounters memory_total;
+static thread_local MemoryTag memory_tag = MemoryTag_Other;
+
+// Sits just before every tracked allocation. The block is what malloc
+// returned, which is further back than the header for over-aligned types.
+struct AllocationHeader {
+    void* block;
+    size_t size;
+    MemoryTag tag;
+};
+
+static const size_t malloc_alignment = alignof(std::max_align_t);
+
+static void RaisePeak(std::atomic<int64_t>& peak, int64_t value) {
+    int64_t previous = peak.load(std::memory_order_relaxed);
+    while (value > previous
+           && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+}
+
+static void Count(MemoryCounters& counters, int64_t bytes, int64_t allocations) {
+    int64_t live = counters.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    counters.live_allocations.fetch_add(allocations, std::memory_order_relaxed);
+    if (allocations > 0) {
+        counters.total_allocations.fetch_add(allocations, std::memory_order_relaxed);
+        RaisePeak(counters.peak_bytes, live);
+    }
+}
+
+static void* TrackedAlloc(size_t size, size_t alignment, MemoryTag tag) {
+    alignment = std::max(alignment, malloc_alignment);
+    size_t offset = (sizeof(AllocationHeader) + alignment - 1) / alignment * alignment;
+    size_t slack = alignment - malloc_alignment;
+    char* block = (char*)malloc(size + offset + slack);
+    if (block == NULL)
+        return NULL;
+
+    uintptr_t address = ((uintptr_t)block + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    AllocationHeader* header = (AllocationHeader*)address - 1;
+    header->block = block;
+    header->size = size;
+    header->tag = tag;
+
+    Count(memory_counters[tag], (int64_t)size, 1);
+    Count(memory_total, (int64_t)size, 1);
+    return (void*)address;
+}
+
+static void TrackedFree(void* p) {
+    if (p == NULL)
+        return;
+    AllocationHeader* header = (AllocationHeader*)p - 1;
+    Count(memory_counters[header->tag], -(int64_t)header->size, -1);
+    Count(memory_total, -(int64_t)header->size, -1);
+    free(header->block);
+}
+
+static void* NewOrThrow(size_t size, size_t alignment) {
+    if (void* p = TrackedAlloc(size ? size : 1, alignment, memory_tag))
+        return p;
+    throw std::bad_alloc();
+}
+
+static void* ImGuiAlloc(size_t size, void* user_data) {
+    return TrackedAlloc(size, malloc_alignment, MemoryTag_Renderer);
+}
+
+static void ImGuiFree(void* p, void* user_data) {
+    TrackedFree(p);
+}
+
+bool MemoryTrackingEnabled() {
+    return true;
+}
+
+static MemoryUsage ReadCounters(const MemoryCounters& counters) {
+    MemoryUsage usage;
+    usage.live_bytes = counters.live_bytes;
+    usage.peak_bytes = counters.peak_bytes;
+    usage.live_allocations = counters.live_allocations;
+    usage.total_allocations = counters.total_allocations;
+    return usage;
+}
+
+MemoryUsage GetMemoryUsage(MemoryTag tag) {
+    if (tag < 0 || tag >= MemoryTag_COUNT)
+        return MemoryUsage();
+    return ReadCounters(memory_counters[tag]);
+}
+
+MemoryUsage GetTotalMemoryUsage() {
+    return ReadCounters(memory_total);
+}
+
+void ResetMemoryPeaks() {
+    for (auto& counters : memory_counters) {
+        counters.peak_bytes = counters.live_bytes.load();
+    }
+    memory_total.peak_bytes = memory_total.live_bytes.load();
+}
+
+void InstallMemoryTracking() {
+    ImGui::SetAllocatorFunctions(ImGuiAlloc, ImGuiFree);
+}
+
+MemoryScope::MemoryScope(MemoryTag tag)
+    : _previous(memory_tag) {
+    memory_tag = tag;
+}
+
+MemoryScope::~MemoryScope() {
+    memory_tag = _previous;
+}
+
+MemoryTag MemoryScope::Current() {
+    return memory_tag;
+}
+
+#else
+
+bool MemoryTrackingEnabled() {
+    return false;
+}
+
+MemoryUsage GetMemoryUsage(MemoryTag tag) {
+    return MemoryUsage();
+}
+
+MemoryUsage GetTotalMemoryUsage() {
+    return MemoryUsage();
+}
+
+void ResetMemoryPeaks() { }
+
+void InstallMemoryTracking() { }
+
+MemoryScope::MemoryScope(MemoryTag tag)
+    : _previous(MemoryTag_Other) { }
+
+MemoryScope::~MemoryScope() { }
+
+MemoryTag MemoryScope::Current() {
+    return MemoryTag_Other;
+}
+
+#endif
+
+static void FormatBytes(char* buffer, size_t size, int64_t bytes) {
+    double value = (double)bytes;
+    if (value >= 1024.0 * 1024.0 * 1024.0) {
+        snprintf(buffer, size, "%.2f GB", value / (1024.0 * 1024.0 * 1024.0));
+    } else if (value >= 1024.0 * 1024.0) {
+        snprintf(buffer, size, "%.2f MB", value / (1024.0 * 1024.0));
+    } else if (value >= 1024.0) {
+        snprintf(buffer, size, "%.1f KB", value / 1024.0);
+    } else {
+        snprintf(buffer, size, "%lld B", (long long)bytes);
+    }
+}
+
+static void DrawUsageRow(const char* name, const MemoryUsage& usage, int64_t total_live) {
+    char live[32];
+    char peak[32];
+    FormatBytes(live, sizeof(live), usage.live_bytes);
+    FormatBytes(peak, sizeof(peak), usage.peak_bytes);
+
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(name);
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(live);
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(peak);
+    ImGui::TableNextColumn();
+    ImGui::Text("%lld", (long long)usage.live_allocations);
+    ImGui::TableNextColumn();
+    float share = total_live > 0 ? (float)usage.live_bytes / total_live : 0.0f;
+    ImGui::ProgressBar(share, ImVec2(-1, 0));
+}
+
+void DrawMemoryPanel(bool* p_open) {
+    if (!ImGui::Begin("Memory", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    if (!MemoryTrackingEnabled()) {
+        ImGui::TextWrapped(
+            "Memory is not tracked in this build. Configure with "
+            "-DRAVEN_MEMORY_TRACKING=ON to count allocations.");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Button("Reset Peaks")) {
+        ResetMemoryPeaks();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Save Report...")) {
+        auto path = SaveFileDialog("txt");
+        if (path != "") {
+            if (WriteMemoryReport(path)) {
+                Message("Saved memory report to %s", path.c_str());
+            } else {
+                Message("Error saving memory report to %s", path.c_str());
+            }
+        }
+    }
+
+    auto total = GetTotalMemoryUsage();
+    int table_flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV
+        | ImGuiTableFlags_SizingStretchProp;
+    if (ImGui::BeginTable("##Memory", 5, table_flags)) {
+        ImGui::TableSetupColumn("Subsystem");
+        ImGui::TableSetupColumn("Live");
+        ImGui::TableSetupColumn("Peak");
+        ImGui::TableSetupColumn("Allocations");
+        ImGui::TableSetupColumn("Share");
+        ImGui::TableHeadersRow();
+        for (int tag = 0; tag < MemoryTag_COUNT; tag++) {
+            DrawUsageRow(
+                MemoryTagName((MemoryTag)tag),
+                GetMemoryUsage((MemoryTag)tag),
+                total.live_bytes);
+        }
+        DrawUsageRow("Total", total, total.live_bytes);
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+bool WriteMemoryReport(std::string path) {
+    bool to_stdout = path == "-";
+    FILE* file = to_stdout ? stdout : fopen(path.c_str(), "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "raven memory report\n");
+    fprintf(file, "file: %s\n", appState.file_path.c_str());
+    if (!MemoryTrackingEnabled()) {
+        fprintf(file, "tracking: disabled (configure with -DRAVEN_MEMORY_TRACKING=ON)\n");
+    } else {
+        fprintf(
+            file,
+            "%-12s %16s %16s %12s %12s\n",
+            "subsystem", "live_bytes", "peak_bytes", "live_allocs", "total_allocs");
+        auto write_row = [&](const char* name, const MemoryUsage& usage) {
+            fprintf(
+                file,
+                "%-12s %16lld %16lld %12lld %12lld\n",
+                name,
+                (long long)usage.live_bytes,
+                (long long)usage.peak_bytes,
+                (long long)usage.live_allocations,
+                (long long)usage.total_allocations);
+        };
+        for (int tag = 0; tag < MemoryTag_COUNT; tag++) {
+            write_row(MemoryTagName((MemoryTag)tag), GetMemoryUsage((MemoryTag)tag));
+        }
+        write_row("total", GetTotalMemoryUsage());
+    }
+
+    bool ok = !ferror(file);
+    if (to_stdout) {
+        return fflush(file) == 0 && ok;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+} // raven
+
+#ifdef RAVEN_MEMORY_TRACKING
+
+// Replace every form of the global allocation functions, so nothing the
+// standard library allocates by another route reaches a tracked delete.
+
+void* operator new(size_t size) {
+    return raven::NewOrThrow(size, raven::malloc_alignment);
+}
+
+void* operator new[](size_t size) {
+    return raven::NewOrThrow(size, raven::malloc_alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return raven::NewOrThrow(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return raven::NewOrThrow(size, (size_t)alignment);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return raven::TrackedAlloc(size ? size : 1, raven::malloc_alignment, raven::memory_tag);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return raven::TrackedAlloc(size ? size : 1, raven::malloc_alignment, raven::memory_tag);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return raven::TrackedAlloc(size ? size : 1, (size_t)alignment, raven::memory_tag);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return raven::TrackedAlloc(size ? size : 1, (size_t)alignment, raven::memory_tag);
+}
+
+void operator delete(void* p) noexcept { raven::TrackedFree(p); }
+void operator delete[](void* p) noexcept { raven::TrackedFree(p); }
+void operator delete(void* p, size_t) noexcept { raven::TrackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { raven::TrackedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { raven::TrackedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { raven::TrackedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { raven::TrackedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { raven::TrackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { raven::TrackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { raven::TrackedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { raven::TrackedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { raven::TrackedFree(p); }
+
+#endif
@@ -0,0 +1,69 @@
+// Memory tracking
+#ifndef RAVEN_MEMORY_TRACKER_H
+#define RAVEN_MEMORY_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace raven {
+
+// What an allocation is charged to. An allocation stays charged to the
+// subsystem that made it, whichever frees it.
+enum MemoryTag {
+    MemoryTag_Other,
+    MemoryTag_Document,   // OTIO objects, as parsed, recovered or edited
+    MemoryTag_Provider,   // the timeline index
+    MemoryTag_Inspector,  // the inspector and markers panels
+    MemoryTag_JSON,       // serialized JSON and the JSON view
+    MemoryTag_Renderer,   // drawing the timeline, and Dear ImGui itself
+    MemoryTag_COUNT
+};
+
+struct MemoryUsage {
+    int64_t live_bytes = 0;
+    int64_t peak_bytes = 0;
+    int64_t live_allocations = 0;
+    int64_t total_allocations = 0;
+};
+
+// Only builds configured with RAVEN_MEMORY_TRACKING count anything; in
+// others every usage reads back as zero, and scopes cost nothing.
+bool MemoryTrackingEnabled();
+
+const char* MemoryTagName(MemoryTag tag);
+MemoryUsage GetMemoryUsage(MemoryTag tag);
+// Summed over every tag. The peak is of the total, not a sum of peaks.
+MemoryUsage GetTotalMemoryUsage();
+// Start each peak again from what's live now
+void ResetMemoryPeaks();
+
+// Route Dear ImGui's allocations through the tracker, charged to the
+// renderer. Call before ImGui::CreateContext.
+void InstallMemoryTracking();
+
+void DrawMemoryPanel(bool* p_open = nullptr);
+
+// Write live and peak usage per tag as text; "-" writes to stdout
+bool WriteMemoryReport(std::string path);
+
+// Charges allocations made on this thread, within the enclosing block,
+// to tag. Scopes nest.
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryTag tag);
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+    // The tag allocations on this thread are charged to right now
+    static MemoryTag Current();
+
+private:
+    MemoryTag _previous;
+};
+
+} // raven
+
+#endif
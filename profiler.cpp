@@ -0,0 +1,315 @@
+// Frame profiler
+
+#include "imgui.h"
+#include "implot.h"
+#include "imgui_internal.h"
+
+#include "profiler.h"
+#include "app.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace raven {
+
+typedef std::chrono::steady_clock ProfileClock;
+
+struct ProfileEvent {
+    const char* name;
+    int64_t start_us;
+    int64_t duration_us;
+    int depth;
+};
+
+struct ProfileCounterValue {
+    const char* name;
+    double value;
+};
+
+struct ProfileFrame {
+    int frame_number = 0;
+    int64_t start_us = 0;
+    float frame_ms = 0;   // time since the previous frame, as Dear ImGui sees it
+    float gui_ms = 0;     // time spent between ProfilerBeginFrame and ProfilerEndFrame
+    int vertices = 0;
+    int commands = 0;
+    int windows = 0;
+    std::vector<ProfileEvent> events;
+    std::vector<ProfileCounterValue> counters;
+};
+
+static const size_t profiler_history_size = 300;
+
+static struct {
+    ProfileClock::time_point epoch = ProfileClock::now();
+    bool in_frame = false;
+    bool paused = false;
+    int depth = 0;
+    ProfileFrame current;
+    std::vector<ProfileFrame> history = std::vector<ProfileFrame>(profiler_history_size);
+    size_t next = 0;   // slot the next finished frame goes into
+    size_t count = 0;  // number of valid frames in history
+} profiler;
+
+static int64_t ProfilerMicroseconds(ProfileClock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - profiler.epoch).count();
+}
+
+// Oldest frame first
+static const ProfileFrame& ProfilerFrame(size_t index) {
+    size_t first = (profiler.next + profiler_history_size - profiler.count) % profiler_history_size;
+    return profiler.history[(first + index) % profiler_history_size];
+}
+
+ProfileScope::ProfileScope(const char* name)
+    : _name(name)
+    , _start(ProfileClock::now()) {
+    profiler.depth++;
+}
+
+ProfileScope::~ProfileScope() {
+    profiler.depth--;
+    if (!profiler.in_frame)
+        return;
+    int64_t start = ProfilerMicroseconds(_start);
+    int64_t end = ProfilerMicroseconds(ProfileClock::now());
+    profiler.current.events.push_back({ _name, start, end - start, profiler.depth });
+}
+
+void ProfilerBeginFrame() {
+    auto& frame = profiler.current;
+    frame.events.clear();
+    frame.counters.clear();
+    frame.frame_number = ImGui::GetFrameCount();
+    frame.start_us = ProfilerMicroseconds(ProfileClock::now());
+    frame.frame_ms = ImGui::GetIO().DeltaTime * 1000.0f;
+    profiler.depth = 0;
+    profiler.in_frame = true;
+}
+
+void ProfilerEndFrame() {
+    if (!profiler.in_frame)
+        return;
+    profiler.in_frame = false;
+
+    auto& frame = profiler.current;
+    frame.gui_ms = (ProfilerMicroseconds(ProfileClock::now()) - frame.start_us) / 1000.0f;
+
+    // Everything submitted this frame is sitting in the windows' draw
+    // lists, waiting for ImGui::Render()
+    frame.vertices = 0;
+    frame.commands = 0;
+    frame.windows = 0;
+    for (ImGuiWindow* window : GImGui->Windows) {
+        if (!window->Active || window->Hidden)
+            continue;
+        frame.vertices += window->DrawList->VtxBuffer.Size;
+        frame.commands += window->DrawList->CmdBuffer.Size;
+        frame.windows++;
+    }
+
+    if (profiler.paused)
+        return;
+
+    // swap rather than copy, so each slot keeps its allocations
+    std::swap(profiler.history[profiler.next], frame);
+    profiler.next = (profiler.next + 1) % profiler_history_size;
+    profiler.count = std::min(profiler.count + 1, profiler_history_size);
+}
+
+void ProfilerCounter(const char* name, double value) {
+    if (!profiler.in_frame)
+        return;
+    profiler.current.counters.push_back({ name, value });
+}
+
+// Per scope statistics, over the whole history
+struct ScopeSummary {
+    const char* name;
+    std::vector<float> ms;  // per frame, summed over calls
+    float total_ms = 0;
+    float max_ms = 0;
+};
+
+static std::vector<ScopeSummary> SummarizeScopes() {
+    std::vector<ScopeSummary> scopes;
+    for (size_t i = 0; i < profiler.count; i++) {
+        for (const auto& event : ProfilerFrame(i).events) {
+            auto scope = std::find_if(scopes.begin(), scopes.end(), [&](const ScopeSummary& s) {
+                return strcmp(s.name, event.name) == 0;
+            });
+            if (scope == scopes.end()) {
+                scopes.push_back(ScopeSummary());
+                scope = scopes.end() - 1;
+                scope->name = event.name;
+                scope->ms.resize(profiler.count, 0.0f);
+            }
+            scope->ms[i] += event.duration_us / 1000.0f;
+        }
+    }
+    for (auto& scope : scopes) {
+        for (float ms : scope.ms) {
+            scope.total_ms += ms;
+            scope.max_ms = std::max(scope.max_ms, ms);
+        }
+    }
+    return scopes;
+}
+
+void DrawProfiler(bool* p_open) {
+    if (!ImGui::Begin("Profiler", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Checkbox("Pause", &profiler.paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        profiler.next = 0;
+        profiler.count = 0;
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(profiler.count == 0);
+    if (ImGui::Button("Export Trace...")) {
+        auto path = SaveFileDialog("json");
+        if (path != "") {
+            if (ExportProfilerTrace(path)) {
+                Message("Saved trace to %s", path.c_str());
+            } else {
+                Message("Error saving trace to %s", path.c_str());
+            }
+        }
+    }
+    ImGui::EndDisabled();
+
+    if (profiler.count == 0) {
+        ImGui::Text("No frames recorded");
+        ImGui::End();
+        return;
+    }
+
+    const auto& last = ProfilerFrame(profiler.count - 1);
+    std::vector<float> frame_ms(profiler.count);
+    std::vector<float> gui_ms(profiler.count);
+    float total_frame_ms = 0;
+    float max_frame_ms = 0;
+    for (size_t i = 0; i < profiler.count; i++) {
+        const auto& frame = ProfilerFrame(i);
+        frame_ms[i] = frame.frame_ms;
+        gui_ms[i] = frame.gui_ms;
+        total_frame_ms += frame.frame_ms;
+        max_frame_ms = std::max(max_frame_ms, frame.frame_ms);
+    }
+    auto scopes = SummarizeScopes();
+
+    ImGui::Text(
+        "Frame: %.2f ms (avg %.2f, max %.2f)  GUI: %.2f ms",
+        last.frame_ms,
+        total_frame_ms / profiler.count,
+        max_frame_ms,
+        last.gui_ms);
+    ImGui::Text(
+        "Windows: %d  Vertices: %d  Draw commands: %d",
+        last.windows,
+        last.vertices,
+        last.commands);
+
+    if (ImPlot::BeginPlot("##FrameTimes", ImVec2(-1, 200), ImPlotFlags_NoMouseText)) {
+        ImPlot::SetupAxes("Frame", "ms", 0, ImPlotAxisFlags_AutoFit);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 0, profiler_history_size, ImPlotCond_Always);
+        ImPlot::PlotLine("Frame", frame_ms.data(), (int)frame_ms.size());
+        ImPlot::PlotLine("GUI", gui_ms.data(), (int)gui_ms.size());
+        for (const auto& scope : scopes) {
+            ImPlot::PlotLine(scope.name, scope.ms.data(), (int)scope.ms.size());
+        }
+        ImPlot::EndPlot();
+    }
+
+    int table_flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV
+        | ImGuiTableFlags_SizingStretchProp;
+    if (ImGui::BeginTable("##Scopes", 4, table_flags)) {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableHeadersRow();
+        for (const auto& scope : scopes) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(scope.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.ms.back());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.total_ms / profiler.count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.max_ms);
+        }
+        ImGui::EndTable();
+    }
+
+    if (!last.counters.empty() && ImGui::BeginTable("##Counters", 2, table_flags)) {
+        ImGui::TableSetupColumn("Counter");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableHeadersRow();
+        for (const auto& counter : last.counters) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(counter.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%g", counter.value);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+static void WriteTraceCounter(FILE* file, const char* name, int64_t ts, double value) {
+    fprintf(
+        file,
+        ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%lld,\"pid\":1,\"tid\":1,\"args\":{\"value\":%g}}",
+        name,
+        (long long)ts,
+        value);
+}
+
+bool ExportProfilerTrace(std::string path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GUI\"}}");
+    for (size_t i = 0; i < profiler.count; i++) {
+        const auto& frame = ProfilerFrame(i);
+        fprintf(
+            file,
+            ",\n{\"name\":\"Frame %d\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1}",
+            frame.frame_number,
+            (long long)frame.start_us,
+            (long long)(frame.gui_ms * 1000.0f));
+        for (const auto& event : frame.events) {
+            fprintf(
+                file,
+                ",\n{\"name\":\"%s\",\"cat\":\"scope\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1}",
+                event.name,
+                (long long)event.start_us,
+                (long long)event.duration_us);
+        }
+        WriteTraceCounter(file, "Frame ms", frame.start_us, frame.frame_ms);
+        WriteTraceCounter(file, "Vertices", frame.start_us, frame.vertices);
+        WriteTraceCounter(file, "Draw commands", frame.start_us, frame.commands);
+        for (const auto& counter : frame.counters) {
+            WriteTraceCounter(file, counter.name, frame.start_us, counter.value);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+} // raven
@@ -0,0 +1,39 @@
+// Frame profiler
+#ifndef RAVEN_PROFILER_H
+#define RAVEN_PROFILER_H
+
+#include <chrono>
+#include <string>
+
+namespace raven {
+
+// Bracket each frame of the GUI. Scopes and counters recorded in between
+// are kept, along with the frame, in a short history.
+void ProfilerBeginFrame();
+void ProfilerEndFrame();
+
+// Record a value for this frame. The name must be a string literal, or
+// otherwise outlive the profiler.
+void ProfilerCounter(const char* name, double value);
+
+void DrawProfiler(bool* p_open = nullptr);
+
+// Write the recorded history in the Chrome trace event format, which
+// can be opened in chrome://tracing or ui.perfetto.dev
+bool ExportProfilerTrace(std::string path);
+
+// Times the enclosing block. The name must be a string literal, or
+// otherwise outlive the profiler.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name);
+    ~ProfileScope();
+
+private:
+    const char* _name;
+    std::chrono::steady_clock::time_point _start;
+};
+
+} // raven
+
+#endif
@@ -0,0 +1,110 @@
+// Worker threads
+
+#include "thread_pool.h"
+#include "memory_tracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace raven {
+
+ThreadPool& ThreadPool::Shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t workers) {
+    _threads.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        _threads.emplace_back(&ThreadPool::Run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _wake.notify_one();
+}
+
+void ThreadPool::Run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _wake.wait(lock, [this]() { return _quit || !_tasks.empty(); });
+        if (_tasks.empty())
+            return;
+        auto task = std::move(_tasks.front());
+        _tasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+// Shared by the calling thread and the helpers it posts. A helper that
+// only gets to run once every index is taken finds nothing to do, and
+// never touches fn, which may be gone by then. Allocations made by the
+// helpers are charged to whatever the caller's were.
+struct ParallelForState {
+    const std::function<void(size_t)>* fn;
+    size_t count;
+    MemoryTag tag;
+    std::atomic<size_t> next { 0 };
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+
+    void Work() {
+        MemoryScope scope(tag);
+        for (size_t i = next++; i < count; i = next++) {
+            (*fn)(i);
+            if (--remaining == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+};
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0)
+        return;
+    if (count == 1 || _threads.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->fn = &fn;
+    state->count = count;
+    state->tag = MemoryScope::Current();
+    state->remaining = count;
+
+    size_t helpers = std::min(count - 1, _threads.size());
+    for (size_t i = 0; i < helpers; ++i) {
+        Post([state]() { state->Work(); });
+    }
+    // the calling thread works too, so this finishes even when every
+    // worker is busy, e.g. when called from one of them
+    state->Work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&]() { return state->remaining == 0; });
+}
+
+} // raven
@@ -0,0 +1,49 @@
+// Worker threads
+#ifndef RAVEN_THREAD_POOL_H
+#define RAVEN_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+namespace raven {
+
+// A fixed set of worker threads, started once, so that splitting work
+// across cores doesn't pay for creating a thread per piece of it.
+class ThreadPool {
+public:
+    // one worker per core, less the thread that calls ParallelFor
+    static ThreadPool& Shared();
+
+    explicit ThreadPool(size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t Workers() const { return _threads.size(); }
+
+    // Call fn(i) for every i in [0, count), across the workers and the
+    // calling thread, and return once every call has returned. Indices
+    // are handed out in order, one at a time, so put the largest pieces
+    // of work first. Safe to call from inside fn, or from a worker.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    void Post(std::function<void()> task);
+    void Run();
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<std::function<void()>> _tasks;
+    bool _quit = false;
+    std::vector<std::thread> _threads;
+};
+
+} // raven
+
+#endif
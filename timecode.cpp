@@ -0,0 +1,243 @@
+// Time formatting
+
+#include "timecode.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+namespace raven {
+
+using opentime::OPENTIME_VERSION::ErrorStatus;
+using opentime::OPENTIME_VERSION::IsDropFrameRate;
+using opentime::OPENTIME_VERSION::RationalTime;
+
+// Everything needed to turn a frame count into timecode at one rate, as
+// RationalTime::to_timecode does. Whether a rate has timecode at all, and
+// whether it drops frames, is asked of OTIO once per rate; if our
+// arithmetic ever disagrees with OTIO on a set of probe times, that rate
+// always goes through OTIO instead.
+struct TimecodeRate {
+    double rate = 0;
+    IsDropFrameRate drop_frame_mode = IsDropFrameRate::InferFromRate;
+    bool valid = false;     // OTIO can make timecode at this rate
+    bool exact = false;     // and we make the same timecode it does
+    bool drop_frame = false;
+    int drop_frames = 0;
+    int nominal_fps = 0;
+    double frames_per_minute = 0;
+    double frames_per_10_minutes = 0;
+    double frames_per_24_hours = 0;
+};
+
+static const size_t timecode_rate_cache_size = 16;
+static TimecodeRate timecode_rates[timecode_rate_cache_size];
+static size_t timecode_rate_count = 0;
+static size_t timecode_rate_next = 0;
+
+// at least two digits, like std::setw(2) << std::setfill('0')
+static char* WriteTwoDigits(char* out, int value) {
+    if (value >= 100) {
+        out += snprintf(out, 12, "%d", value);
+        return out;
+    }
+    *out++ = (char)('0' + value / 10);
+    *out++ = (char)('0' + value % 10);
+    return out;
+}
+
+// out must have room for at least 16 characters
+static void WriteTimecode(char* out, double value, const TimecodeRate& r) {
+    // roll over after 24 hours
+    value = fmod(value, r.frames_per_24_hours);
+
+    if (r.drop_frame) {
+        double ten_minute_chunks = floor(value / r.frames_per_10_minutes);
+        int frames_over_ten_minutes = (int)fmod(value, r.frames_per_10_minutes);
+        value += r.drop_frames * 9 * ten_minute_chunks;
+        if (frames_over_ten_minutes > r.drop_frames) {
+            value += r.drop_frames
+                * floor((frames_over_ten_minutes - r.drop_frames) / (int)r.frames_per_minute);
+        }
+    }
+
+    int frames = (int)fmod(value, r.nominal_fps);
+    int seconds_total = (int)floor(value / r.nominal_fps);
+    int seconds = seconds_total % 60;
+    int minutes = (seconds_total / 60) % 60;
+    int hours = seconds_total / 3600;
+
+    out = WriteTwoDigits(out, hours);
+    *out++ = ':';
+    out = WriteTwoDigits(out, minutes);
+    *out++ = ':';
+    out = WriteTwoDigits(out, seconds);
+    *out++ = r.drop_frame ? ';' : ':';
+    out = WriteTwoDigits(out, frames);
+    *out = '\0';
+}
+
+static TimecodeRate MakeTimecodeRate(double rate, IsDropFrameRate drop_frame_mode) {
+    TimecodeRate r;
+    r.rate = rate;
+    r.drop_frame_mode = drop_frame_mode;
+
+    ErrorStatus error_status;
+    auto zero = RationalTime(0, rate).to_timecode(rate, drop_frame_mode, &error_status);
+    r.valid = !opentime::OPENTIME_VERSION::is_error(error_status);
+    if (!r.valid)
+        return r;
+
+    r.drop_frame = zero.find(';') != std::string::npos;
+    r.drop_frames = r.drop_frame ? (int)round(rate * 0.066666) : 0;
+    r.nominal_fps = (int)ceil(rate);
+    r.frames_per_minute = round(rate) * 60 - r.drop_frames;
+    r.frames_per_10_minutes = round(rate * 60 * 10);
+    r.frames_per_24_hours = round(rate * 60 * 60) * 24;
+
+    // frame, second, minute and ten minute boundaries, where dropped
+    // frames and roll over happen
+    const double probes[] = {
+        0, 1, r.frames_per_minute - 1, r.frames_per_minute, r.frames_per_minute + 1,
+        r.frames_per_10_minutes - 1, r.frames_per_10_minutes, r.frames_per_10_minutes + 1,
+        r.frames_per_10_minutes * 6 + r.frames_per_minute * 3 + 7,
+        r.frames_per_24_hours - 1, r.frames_per_24_hours + 1
+    };
+    r.exact = true;
+    char buf[32];
+    for (double probe : probes) {
+        WriteTimecode(buf, probe, r);
+        if (RationalTime(probe, rate).to_timecode(rate, drop_frame_mode, &error_status) != buf
+            || opentime::OPENTIME_VERSION::is_error(error_status)) {
+            r.exact = false;
+            break;
+        }
+    }
+    return r;
+}
+
+static const TimecodeRate& TimecodeRateFor(double rate, IsDropFrameRate drop_frame_mode) {
+    for (size_t i = 0; i < timecode_rate_count; i++) {
+        const auto& r = timecode_rates[i];
+        if (r.rate == rate && r.drop_frame_mode == drop_frame_mode)
+            return r;
+    }
+    // there are only ever a handful of rates in use, so just go round
+    size_t slot = timecode_rate_next;
+    timecode_rate_next = (timecode_rate_next + 1) % timecode_rate_cache_size;
+    if (timecode_rate_count < timecode_rate_cache_size)
+        timecode_rate_count++;
+    timecode_rates[slot] = MakeTimecodeRate(rate, drop_frame_mode);
+    return timecode_rates[slot];
+}
+
+// Appends to a fixed buffer, truncating if it fills up
+struct TimeStringWriter {
+    char* buf;
+    size_t size;
+    size_t length;
+
+    void Separate() {
+        if (length > 0)
+            Append("\n");
+    }
+    void Append(const char* text) {
+        size_t n = strlen(text);
+        if (length + n >= size)
+            n = size - 1 - length;
+        memcpy(buf + length, text, n);
+        length += n;
+        buf[length] = '\0';
+    }
+};
+
+static void WriteTimecodeField(TimeStringWriter* writer, RationalTime time, IsDropFrameRate drop_frame_mode) {
+    const auto& r = TimecodeRateFor(time.rate(), drop_frame_mode);
+    if (r.valid && r.exact && time.value() >= 0) {
+        char timecode[32];
+        WriteTimecode(timecode, time.value(), r);
+        writer->Append(timecode);
+        return;
+    }
+    ErrorStatus error_status;
+    auto timecode = time.to_timecode(time.rate(), drop_frame_mode, &error_status);
+    if (opentime::OPENTIME_VERSION::is_error(error_status)) {
+        // non-standard rates can't be turned into timecode
+        // so fall back to a time string, which is HH:MM:SS.xxx
+        // where xxx is a fraction instead of a :FF frame.
+        timecode = time.to_time_string();
+    }
+    writer->Append(timecode.c_str());
+}
+
+// Recently formatted times. Ruler ticks, the playhead and the transport
+// bar ask for mostly the same times from one frame to the next.
+struct TimeStringCacheEntry {
+    double value;
+    double rate;
+    int flags = -1;
+    IsDropFrameRate drop_frame_mode;
+    uint64_t last_used = 0;
+    char text[TimeStringSize];
+};
+
+static const size_t time_string_cache_size = 64;
+static TimeStringCacheEntry time_string_cache[time_string_cache_size];
+static uint64_t time_string_clock = 0;
+
+const char* FormatTime(char* buf,
+                       size_t size,
+                       RationalTime time,
+                       int flags,
+                       IsDropFrameRate drop_frame_mode) {
+    if (size == 0)
+        return buf;
+
+    TimeStringCacheEntry* oldest = &time_string_cache[0];
+    for (auto& entry : time_string_cache) {
+        if (entry.flags == flags && entry.value == time.value() && entry.rate == time.rate()
+            && entry.drop_frame_mode == drop_frame_mode) {
+            entry.last_used = ++time_string_clock;
+            snprintf(buf, size, "%s", entry.text);
+            return buf;
+        }
+        if (entry.last_used < oldest->last_used)
+            oldest = &entry;
+    }
+
+    TimeStringWriter writer = { oldest->text, sizeof(oldest->text), 0 };
+    oldest->text[0] = '\0';
+    char field[64];
+    if (flags & TimeFormat_Timecode) {
+        writer.Separate();
+        WriteTimecodeField(&writer, time, drop_frame_mode);
+    }
+    if (flags & TimeFormat_Frames) {
+        writer.Separate();
+        snprintf(field, sizeof(field), "%df", time.to_frames());
+        writer.Append(field);
+    }
+    if (flags & TimeFormat_Seconds) {
+        writer.Separate();
+        snprintf(field, sizeof(field), "%.5fs", time.to_seconds());
+        writer.Append(field);
+    }
+    if (flags & TimeFormat_Rate) {
+        writer.Separate();
+        snprintf(field, sizeof(field), "@%.3f", time.rate());
+        writer.Append(field);
+    }
+    oldest->value = time.value();
+    oldest->rate = time.rate();
+    oldest->flags = flags;
+    oldest->drop_frame_mode = drop_frame_mode;
+    oldest->last_used = ++time_string_clock;
+
+    snprintf(buf, size, "%s", oldest->text);
+    return buf;
+}
+
+} // raven
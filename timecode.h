@@ -0,0 +1,35 @@
+// Time formatting
+#ifndef RAVEN_TIMECODE_H
+#define RAVEN_TIMECODE_H
+
+#include <opentime/rationalTime.h>
+
+#include <stddef.h>
+
+namespace raven {
+
+// Large enough for every field of FormatTime at once
+constexpr size_t TimeStringSize = 128;
+
+enum TimeFormatFlags_ {
+    TimeFormat_Timecode = 1 << 0,   // HH:MM:SS:FF, or a time string at rates without timecode
+    TimeFormat_Frames   = 1 << 1,   // 1234f
+    TimeFormat_Seconds  = 1 << 2,   // 51.41667s
+    TimeFormat_Rate     = 1 << 3,   // @24.000
+};
+
+// Write the fields selected by flags into buf, one per line, and return
+// buf. Timecode matches RationalTime::to_timecode at the time's own rate,
+// but is computed from per-rate constants instead, and recently formatted
+// times are kept in a small LRU cache. Nothing is allocated, except on
+// the fallback paths for negative times and unusual rates.
+// Not thread safe; call from the UI thread.
+const char* FormatTime(char* buf,
+                       size_t size,
+                       opentime::OPENTIME_VERSION::RationalTime time,
+                       int flags,
+                       opentime::OPENTIME_VERSION::IsDropFrameRate drop_frame_mode);
+
+} // raven
+
+#endif
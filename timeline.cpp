@@ -5,6 +5,8 @@
 #include "widgets.h"
 #include "editing.h"
 #include "colors.h"
+#include "profiler.h"
+#include "main.h"
 
 #include <opentimelineio/clip.h>
 #include <opentimelineio/composable.h>
@@ -43,17 +45,15 @@ void DrawItem(
     if (nodeKind == TimelineProvider::NodeKind::Transition)
         return;
 
-    otio::SerializableObject::Retainer<otio::Composable> comp = op->OtioFromNode(itemNode).value;
-    auto item = dynamic_cast<otio::Item*>(comp.value);
+    auto item = dynamic_cast<otio::Item*>(op->OtioFromNode(itemNode).value);
     assert(item);
     if (!item)
         return;
 
-    const std::string emptyStr;
-    const std::string& label_str = nodeKind == TimelineProvider::NodeKind::Gap ? emptyStr : op->Name(itemNode);
+    std::string_view label_str = nodeKind == TimelineProvider::NodeKind::Gap ? std::string_view("", 0) : op->Name(itemNode);
     auto item_range = op->NodeTimeRange(itemNode);
     if (item_range == otio::TimeRange()) {
-        Log("Couldn't find %s in range map", label_str.c_str());
+        Log("Couldn't find %s in range map", label_str.data());
         assert(false);
         return;
     }
@@ -173,8 +173,8 @@ void DrawItem(
 
     if (show_label) {
         const ImVec2 text_pos = ImVec2(p0.x + text_offset.x, p0.y + text_offset.y);
-        if (label_str != "") {
-            draw_list->AddText(text_pos, label_color, label_str.c_str());
+        if (!label_str.empty()) {
+            draw_list->AddText(text_pos, label_color, label_str.data(), label_str.data() + label_str.size());
         }
     }
     if (show_time_range) {
@@ -203,13 +203,14 @@ void DrawItem(
         if (const auto& comp = dynamic_cast<otio::Composition*>(item)) {
             extra = "\nChildren: " + std::to_string(comp->children().size());
         }
+        char start_str[TimeStringSize], end_str[TimeStringSize], duration_str[TimeStringSize];
         ImGui::SetTooltip(
                           "%s: %s\nRange: %s - %s\nDuration: %s%s",
                           item->schema_name().c_str(),
-                          label_str.c_str(),
-                          FormattedStringFromTime(item_range.start_time()).c_str(),
-                          FormattedStringFromTime(item_range.end_time_inclusive()).c_str(),
-                          FormattedStringFromTime(duration).c_str(),
+                          label_str.data(),
+                          FormattedStringFromTime(start_str, sizeof(start_str), item_range.start_time()),
+                          FormattedStringFromTime(end_str, sizeof(end_str), item_range.end_time_inclusive()),
+                          FormattedStringFromTime(duration_str, sizeof(duration_str), duration),
                           extra.c_str());
     }
 
@@ -242,10 +243,10 @@ void DrawTransition(
     auto duration = op->Duration(transitionNode);
     float width = duration.to_seconds() * scale;
 
-    const std::string& transition_name = op->Name(transitionNode);
+    std::string_view transition_name = op->Name(transitionNode);
     auto item_range = op->NodeTimeRange(transitionNode);
     if (item_range == otio::TimeRange()) {
-        Log("Couldn't find %s in range map?!", transition_name.c_str());
+        Log("Couldn't find %s in range map?!", transition_name.data());
         assert(false);
     }
 
@@ -302,13 +303,14 @@ void DrawTransition(
     draw_list->AddLine(line_start, line_end, line_color);
 
     if (ImGui::IsItemHovered()) {
+        char in_str[TimeStringSize], out_str[TimeStringSize], duration_str[TimeStringSize];
         ImGui::SetTooltip(
                           "%s: %s\nIn/Out Offset: %s / %s\nDuration: %s",
                           transition->schema_name().c_str(),
-                          transition_name.c_str(),
-                          FormattedStringFromTime(transition->in_offset()).c_str(),
-                          FormattedStringFromTime(transition->out_offset()).c_str(),
-                          FormattedStringFromTime(duration).c_str());
+                          transition_name.data(),
+                          FormattedStringFromTime(in_str, sizeof(in_str), transition->in_offset()),
+                          FormattedStringFromTime(out_str, sizeof(out_str), transition->out_offset()),
+                          FormattedStringFromTime(duration_str, sizeof(duration_str), duration));
     }
 
     ImGui::PopClipRect();
@@ -337,11 +339,11 @@ void DrawEffects(
     if (effects.size() == 0)
         return;
 
-    const std::string& effect_name = op->Name(itemNode);
+    std::string_view effect_name = op->Name(itemNode);
 
     auto item_range = op->NodeTimeRange(itemNode);
     if (item_range == otio::TimeRange()) {
-        Log("Couldn't find %s in range map?!", effect_name.c_str());
+        Log("Couldn't find %s in range map?!", effect_name.data());
         assert(false);
         return;
     }
@@ -350,7 +352,7 @@ void DrawEffects(
     for (const auto& effect : effects) {
         if (label_str != "")
             label_str += ", ";
-        label_str += effect_name != "" ? effect->name()
+        label_str += !effect_name.empty() ? effect->name()
         : effect->effect_name();
     }
     const auto text_size = ImGui::CalcTextSize(label_str.c_str());
@@ -407,10 +409,10 @@ void DrawEffects(
         if (ImGui::IsItemClicked()) {
             SelectObject(effect, item);
         }
-        /// @TODO effects needs to match the abstraction
-        //if (tp->selected_object == effect) {
-        //    fill_color = selected_fill_color;
-        //}
+        auto effectNodes = op->Effects(itemNode);
+        if (!effectNodes.empty() && tp->selected_object == effectNodes[0]) {
+            fill_color = selected_fill_color;
+        }
     } else {
         if (ImGui::IsItemClicked()) {
             SelectObject(item);
@@ -440,7 +442,8 @@ void DrawEffects(
         for (const auto& effect : effects) {
             if (tooltip != "")
                 tooltip += "\n\n";
-            tooltip += effect->schema_name() + ": " + effect_name;
+            tooltip += effect->schema_name() + ": ";
+            tooltip += effect_name;
             tooltip += "\nEffect Name: " + effect->effect_name();
             if (const auto& timewarp = dynamic_cast<otio::LinearTimeWarp*>(effect.value)) {
                 tooltip += "\nTime Scale: " + std::to_string(timewarp->time_scalar());
@@ -465,30 +468,27 @@ void DrawMarkers(
                  bool offsetInParent)
 {
     OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
-    auto itemComp = op->OtioFromNode(itemNode).value;
-    otio::Item* item = dynamic_cast<otio::Item*>(itemComp);
-    if (item == nullptr)
-        return;
-
-    auto markers = item->markers();
+    auto markers = op->Markers(itemNode);
     if (markers.size() == 0)
         return;
 
-    otio::TimeRange item_start_in_parent = op->NodeTimeRange(itemNode);
-    auto item_trimmed_start = item->trimmed_range().start_time();
+    auto item = op->OtioFromNode(itemNode).value;
+    for (auto markerNode : markers) {
+        auto marker = dynamic_cast<otio::Marker*>(op->OtioFromNode(markerNode).value);
+        if (marker == nullptr)
+            continue;
 
-    for (const auto& marker : markers) {
         auto range = marker->marked_range();
         auto duration = range.duration();
-        auto start = range.start_time();
+        // the provider has already mapped the range into timeline coordinates
+        auto timeline_range = op->NodeTimeRange(markerNode);
 
         const float arrow_width = height / 4;
         float width = duration.to_seconds() * scale + arrow_width;
 
         ImVec2 size(width, arrow_width);
         ImVec2 render_pos(
-                          (item_start_in_parent.start_time() + (start - item_trimmed_start)).to_seconds()
-                          * scale
+                          timeline_range.start_time().to_seconds() * scale
                           + origin.x - arrow_width / 2,
                           ImGui::GetCursorPosY());
 
@@ -499,7 +499,7 @@ void DrawMarkers(
         auto old_pos = ImGui::GetCursorPos();
         ImGui::SetCursorPos(render_pos);
 
-        ImGui::PushID((int) op->StationaryId(itemNode));
+        ImGui::PushID((int) op->StationaryId(markerNode));
         ImGui::BeginGroup();
 
         ImGui::InvisibleButton("##Marker", size);
@@ -520,10 +520,9 @@ void DrawMarkers(
         if (ImGui::IsItemClicked()) {
             SelectObject(marker, item);
         }
-        /// @TODO abstract this and restore
-        //if (tp->selected_object == marker) {
-        //    fill_color = selected_fill_color;
-        //}
+        if (tp->selected_object == markerNode) {
+            fill_color = selected_fill_color;
+        }
 
         ImGui::PushClipRect(p0, p1, true);
         ImDrawList* draw_list = ImGui::GetWindowDrawList();
@@ -546,14 +545,15 @@ void DrawMarkers(
                                      fill_color);
 
         if (ImGui::IsItemHovered()) {
+            char start_str[TimeStringSize], end_str[TimeStringSize], duration_str[TimeStringSize];
             ImGui::SetTooltip(
                               "%s: %s\nColor: %s\nRange: %s - %s\nDuration: %s",
                               marker->schema_name().c_str(),
                               marker->name().c_str(),
                               marker->color().c_str(),
-                              FormattedStringFromTime(range.start_time()).c_str(),
-                              FormattedStringFromTime(range.end_time_exclusive()).c_str(),
-                              FormattedStringFromTime(duration).c_str());
+                              FormattedStringFromTime(start_str, sizeof(start_str), range.start_time()),
+                              FormattedStringFromTime(end_str, sizeof(end_str), range.end_time_exclusive()),
+                              FormattedStringFromTime(duration_str, sizeof(duration_str), duration));
         }
 
         ImGui::PopClipRect();
@@ -595,10 +595,10 @@ void DrawObjectLabel(TimelineProviderHarness* tp,
         SelectObject(object);
     }
 
-    /// @TODO abstract and restore
-    //if (tp->selected_object == object) {
-    //    fill_color = selected_fill_color;
-    //}
+    OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
+    if (tp->selected_object == op->NodeFromOtio(object)) {
+        fill_color = selected_fill_color;
+    }
     if (ColorIsBright(fill_color)) {
         label_color = ColorInvert(label_color);
     }
@@ -629,15 +629,15 @@ void DrawTrackLabel(TimelineProviderHarness* tp,
     ImVec2 size(width, height);
     ImGui::InvisibleButton("##empty", size);
 
-    const auto& trackName = op->Name(trackNode);
+    std::string_view trackName = op->Name(trackNode);
     char label_str[200];
     snprintf(
              label_str,
              sizeof(label_str),
              "%c%d: %s",
-             op->Name(trackNode).c_str()[0],
+             op->Name(trackNode).data()[0],
              index,
-             trackName.c_str());
+             trackName.data());
 
     auto label_color = appTheme.colors[AppThemeCol_Label];
     auto fill_color = appTheme.colors[AppThemeCol_Track];
@@ -680,21 +680,96 @@ void DrawTrackLabel(TimelineProviderHarness* tp,
 
     if (ImGui::IsItemHovered()) {
         auto trimmed_range = track->trimmed_range();
+        char start_str[TimeStringSize], end_str[TimeStringSize], duration_str[TimeStringSize];
         ImGui::SetTooltip(
                           "%s: %s\n%s #%d\nRange: %s - %s\nDuration: %s\nChildren: %ld",
                           track->schema_name().c_str(),
-                          trackName.c_str(),
-                          op->Name(trackNode).c_str(),
+                          trackName.data(),
+                          op->Name(trackNode).data(),
                           index,
-                          FormattedStringFromTime(trimmed_range.start_time()).c_str(),
-                          FormattedStringFromTime(trimmed_range.end_time_inclusive()).c_str(),
-                          FormattedStringFromTime(trimmed_range.duration()).c_str(),
+                          FormattedStringFromTime(start_str, sizeof(start_str), trimmed_range.start_time()),
+                          FormattedStringFromTime(end_str, sizeof(end_str), trimmed_range.end_time_inclusive()),
+                          FormattedStringFromTime(duration_str, sizeof(duration_str), trimmed_range.duration()),
                           track->children().size());
     }
 
     ImGui::EndGroup();
 }
 
+// Draw a run of children that are too small to see one by one as a single
+// bar, shaded by how much of it is covered by clips rather than gaps.
+void DrawLodSpan(
+                 TimelineProviderHarness* tp,
+                 const TimelineProvider::LodLevel& lod,
+                 size_t span,
+                 float scale,
+                 ImVec2 origin,
+                 float height)
+{
+    double start = lod.starts[span];
+    double end = lod.ends[span];
+    float x = start * scale + origin.x;
+    float width = fmaxf(1.0f, (end - start) * scale);
+
+    ImVec2 screen = ImGui::GetCursorScreenPos();
+    ImVec2 p0(screen.x + x - ImGui::GetCursorPosX(), screen.y);
+    ImVec2 p1(p0.x + width, p0.y + height);
+    if (!ImGui::IsRectVisible(p0, p1))
+        return;
+
+    float density = end > start ? lod.covered[span] / (end - start) : 1.0f;
+    ImColor fill_color(appTheme.colors[AppThemeCol_Item]);
+    fill_color.Value.w *= 0.35f + 0.65f * fminf(1.0f, density);
+
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddRectFilled(p0, p1, fill_color);
+
+    if (ImGui::IsWindowHovered() && ImGui::IsMouseHoveringRect(p0, p1)) {
+        double rate = tp->playhead.rate();
+        char start_str[TimeStringSize], end_str[TimeStringSize];
+        ImGui::SetTooltip(
+                          "%u items\nRange: %s - %s",
+                          lod.count[span],
+                          FormattedStringFromTime(start_str, sizeof(start_str), otio::RationalTime::from_seconds(start, rate)),
+                          FormattedStringFromTime(end_str, sizeof(end_str), otio::RationalTime::from_seconds(end, rate)));
+    }
+}
+
+// Zoomed out, draw the track from its level-of-detail pyramid: merged runs
+// as bars, and the children that are still big enough the usual way. This
+// visits at most a few spans per pixel, however many children there are.
+void DrawTrackLod(
+                  TimelineProviderHarness* tp,
+                  NodeSpan children,
+                  const TimelineProvider::LodLevel& lod,
+                  std::pair<size_t, size_t> visible,
+                  float scale,
+                  ImVec2 origin,
+                  float height)
+{
+    auto is_single = [&](size_t span) {
+        return lod.count[span] == 1 && (lod.ends[span] - lod.starts[span]) * scale >= 1;
+    };
+    for (size_t i = visible.first; i < visible.second; ++i) {
+        if (is_single(i)) {
+            DrawItem(tp, children[lod.first[i]], scale, origin, height);
+        } else {
+            DrawLodSpan(tp, lod, i, scale, origin, height);
+        }
+    }
+    for (size_t i = visible.first; i < visible.second; ++i) {
+        if (is_single(i)) {
+            DrawTransition(tp, children[lod.first[i]], scale, origin, height);
+        }
+    }
+    for (size_t i = visible.first; i < visible.second; ++i) {
+        if (is_single(i)) {
+            DrawEffects(tp, children[lod.first[i]], scale, origin, height);
+            DrawMarkers(tp, children[lod.first[i]], scale, origin, height, true);
+        }
+    }
+}
+
 void DrawTrack(
                TimelineProviderHarness* tp,
                TimelineNode trackNode,
@@ -705,17 +780,33 @@ void DrawTrack(
 {
     auto children = tp->Provider()->SeqStarts(trackNode);
 
+    // Only visit the children that overlap the scrolled viewport, padded
+    // a little so that marker arrows hanging off an edge are not clipped.
+    float scroll_x = ImGui::GetScrollX();
+    float view_width = ImGui::GetWindowWidth();
+    double visible_start = (scroll_x - origin.x - height) / scale;
+    double visible_end = (scroll_x + view_width - origin.x + height) / scale;
     ImGui::BeginGroup();
 
-    for (const auto& child : children) {
-        DrawItem(tp, child, scale, origin, height);
+    if (auto lod = tp->Provider()->SeqLod(trackNode, 1.0 / scale)) {
+        auto visible = lod->SpansInRange(visible_start, visible_end);
+        DrawTrackLod(tp, children, *lod, visible, scale, origin, height);
+        ImGui::EndGroup();
+        __tracks_rendered++;
+        return;
     }
-    for (const auto& child : children) {
-        DrawTransition(tp, child, scale, origin, height);
+
+    auto visible = tp->Provider()->SeqStartsInRange(trackNode, visible_start, visible_end);
+
+    for (size_t i = visible.first; i < visible.second; ++i) {
+        DrawItem(tp, children[i], scale, origin, height);
+    }
+    for (size_t i = visible.first; i < visible.second; ++i) {
+        DrawTransition(tp, children[i], scale, origin, height);
     }
-    for (const auto& child : children) {
-        DrawEffects(tp, child, scale, origin, height);
-        DrawMarkers(tp, child, scale, origin, height, true);
+    for (size_t i = visible.first; i < visible.second; ++i) {
+        DrawEffects(tp, children[i], scale, origin, height);
+        DrawMarkers(tp, children[i], scale, origin, height, true);
     }
 
     ImGui::EndGroup();
@@ -723,6 +814,184 @@ void DrawTrack(
     __tracks_rendered++;
 }
 
+// The tick layout of one ruler, kept from frame to frame while the view of
+// it stays the same. Tick positions follow from a handful of numbers, so
+// only the labels of the ticks on screen are stored, and those are redone
+// only when the visible range of ticks moves.
+struct RulerLabel {
+    int tick_index;
+    float width;
+    size_t text_offset;     // into RulerLayout::label_text
+};
+
+struct RulerLayout {
+    // what the layout was computed for
+    double start_value = 0;
+    double start_rate = 0;
+    float frame_rate = 0;
+    float scale = 0;
+    float width = 0;
+    float font_size = 0;
+    int format_flags = -1;
+    int drop_frame_mode = 0;
+
+    double tick_width = 0;
+    double seconds_per_tick = 0;
+    double tick_offset_x = 0;
+    double first_tick_frame = 0;    // value of the first tick's time, at frame_rate
+    int tick_duration_in_frames = 0;
+    int tick_count = 0;
+    int label_stride = 1;           // label every this many ticks, so they can't overlap
+
+    int first_label_tick = 0;
+    int last_label_tick = 0;
+    std::vector<RulerLabel> labels;
+    std::string label_text;
+
+    int last_used_frame = 0;
+};
+
+static std::unordered_map<const void*, RulerLayout> rulerLayouts;
+
+// forget the layouts of rulers that haven't been drawn for a while
+static void PruneRulerLayouts() {
+    int frame = ImGui::GetFrameCount();
+    if (frame % 60 != 0)
+        return;
+    for (auto it = rulerLayouts.begin(); it != rulerLayouts.end();) {
+        if (frame - it->second.last_used_frame > 60) {
+            it = rulerLayouts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static RulerLayout& RulerLayoutFor(
+                                   const void* ptr_id,
+                                   otio::RationalTime start,
+                                   float frame_rate,
+                                   float scale,
+                                   float width,
+                                   float text_offset_x)
+{
+    auto& layout = rulerLayouts[ptr_id];
+    layout.last_used_frame = ImGui::GetFrameCount();
+    int format_flags = DisplayTimeFormatFlags();
+    if (layout.start_value == start.value() && layout.start_rate == start.rate()
+        && layout.frame_rate == frame_rate && layout.scale == scale
+        && layout.width == width && layout.font_size == ImGui::GetFontSize()
+        && layout.format_flags == format_flags
+        && layout.drop_frame_mode == (int)appState.drop_frame_mode) {
+        return layout;
+    }
+
+    layout.start_value = start.value();
+    layout.start_rate = start.rate();
+    layout.frame_rate = frame_rate;
+    layout.scale = scale;
+    layout.width = width;
+    layout.font_size = ImGui::GetFontSize();
+    layout.format_flags = format_flags;
+    layout.drop_frame_mode = (int)appState.drop_frame_mode;
+    layout.labels.clear();
+    layout.label_text.clear();
+    layout.first_label_tick = layout.last_label_tick = 0;
+
+    // draw every frame?
+    // Note: "width" implies pixels, but "duration" implies time.
+    double single_frame_width = scale / frame_rate;
+    double tick_width = single_frame_width;
+    double min_tick_width = 15;
+    if (tick_width < min_tick_width) {
+        // every second?
+        tick_width = scale;
+        if (tick_width < min_tick_width) {
+            // every minute?
+            tick_width = scale * 60.0f;
+            if (tick_width < min_tick_width) {
+                // every hour
+                tick_width = scale * 60.0f * 60.0f;
+            }
+        }
+    }
+
+    // tick marks - roughly every N pixels
+    double pixels_per_second = scale;
+    layout.tick_width = tick_width;
+    layout.seconds_per_tick = tick_width / pixels_per_second;
+    // ticks must use frame_rate, and must have an integer value
+    // so that the tick labels align to the human expectation of "frames"
+    layout.tick_duration_in_frames = ceil(layout.seconds_per_tick / frame_rate);
+    layout.tick_count = ceil(width / tick_width);
+    // start_floor_time and tick_offset_x adjust the display for cases where
+    // the item's start_time is not on a whole frame boundary.
+    auto start_floor_time = otio::RationalTime(floor(start.value()), start.rate());
+    auto tick_offset = (start - start_floor_time).rescaled_to(frame_rate);
+    layout.tick_offset_x = tick_offset.to_seconds() * scale;
+    layout.first_tick_frame = (start.rescaled_to(frame_rate) - tick_offset).value();
+
+    // Labels are all about the same width, so the first and last are
+    // enough to space them out.
+    char label[TimeStringSize];
+    float label_width = 0;
+    int last_tick = std::max(0, layout.tick_count - 1);
+    for (int tick_index : { 0, last_tick }) {
+        auto tick_time = otio::RationalTime(
+                                            layout.first_tick_frame + tick_index * layout.tick_duration_in_frames,
+                                            frame_rate);
+        FormattedStringFromTime(label, sizeof(label), tick_time);
+        label_width = fmax(label_width, ImGui::CalcTextSize(label).x);
+    }
+    layout.label_stride = std::max(1, (int)ceil((label_width + text_offset_x * 2) / tick_width));
+    return layout;
+}
+
+// (Re)label the ticks in [first_tick, last_tick), if they aren't already
+static void LayoutRulerLabels(RulerLayout& layout, int first_tick, int last_tick) {
+    // a label starts at its tick, so one from a little earlier may still show
+    first_tick = std::max(0, first_tick - first_tick % layout.label_stride - layout.label_stride);
+    if (first_tick == layout.first_label_tick && last_tick == layout.last_label_tick)
+        return;
+    layout.first_label_tick = first_tick;
+    layout.last_label_tick = last_tick;
+    layout.labels.clear();
+    layout.label_text.clear();
+
+    char label[TimeStringSize];
+    for (int tick_index = first_tick; tick_index < last_tick; tick_index += layout.label_stride) {
+        auto tick_time = otio::RationalTime(
+                                            layout.first_tick_frame + tick_index * layout.tick_duration_in_frames,
+                                            layout.frame_rate);
+        FormattedStringFromTime(label, sizeof(label), tick_time);
+        layout.labels.push_back({ tick_index, ImGui::CalcTextSize(label).x, layout.label_text.size() });
+        layout.label_text.append(label);
+        layout.label_text.push_back('\0');
+    }
+}
+
+// Light and dark halves, for alternating frames. Each half is many texels
+// wide so that backends which filter linearly only soften the edges, and
+// the whole is a power of two since WebGL 1 won't repeat anything else.
+static ImTextureID ZebraTexture() {
+    static bool created = false;
+    static ImTextureID texture = NULL;
+    if (!created) {
+        created = true;
+        const int zebra_texture_width = 128;
+        unsigned char pixels[zebra_texture_width * 4];
+        for (int i = 0; i < zebra_texture_width; i++) {
+            unsigned char value = i < zebra_texture_width / 2 ? 255 : 0;
+            pixels[i * 4 + 0] = value;
+            pixels[i * 4 + 1] = value;
+            pixels[i * 4 + 2] = value;
+            pixels[i * 4 + 3] = 255;
+        }
+        texture = CreateRepeatingTexture(zebra_texture_width, 1, pixels);
+    }
+    return texture;
+}
+
 void DrawTimecodeRuler(
                        TimelineProviderHarness* tp,
                        const void* ptr_id,
@@ -763,62 +1032,49 @@ void DrawTimecodeRuler(
     // background
     // draw_list->AddRectFilled(p0, p1, fill_color);
 
-    // draw every frame?
-    // Note: "width" implies pixels, but "duration" implies time.
-    double single_frame_width = scale / frame_rate;
-    double tick_width = single_frame_width;
-    double min_tick_width = 15;
-    if (tick_width < min_tick_width) {
-        // every second?
-        tick_width = scale;
-        if (tick_width < min_tick_width) {
-            // every minute?
-            tick_width = scale * 60.0f;
-            if (tick_width < min_tick_width) {
-                // every hour
-                tick_width = scale * 60.0f * 60.0f;
-            }
-        }
+    auto& layout = RulerLayoutFor(ptr_id, start, frame_rate, scale, width, text_offset.x);
+    double tick_width = layout.tick_width;
+
+    // Only the ticks that overlap the clip rect, found without visiting the
+    // rest, since a zoomed in ruler can have millions of them.
+    double clip_min_x = draw_list->GetClipRectMin().x - p0.x + layout.tick_offset_x;
+    double clip_max_x = draw_list->GetClipRectMax().x - p0.x + layout.tick_offset_x;
+    int first_tick = std::max(0, (int)floor(clip_min_x / tick_width));
+    int last_tick = std::min(layout.tick_count, (int)ceil(clip_max_x / tick_width) + 1);
+
+    // Once individual frames are visible, draw dark/light stripes instead of
+    // tick lines. Each tick is then one frame, so a texture with a light and
+    // a dark half, repeated once every two ticks, covers all of them with a
+    // single quad however far in we zoom.
+    bool zebra = layout.seconds_per_tick < 0.5;
+    ImTextureID zebra_texture = zebra && first_tick < last_tick ? ZebraTexture() : NULL;
+    if (zebra_texture) {
+        int first_frame = (int)(layout.first_tick_frame + first_tick * layout.tick_duration_in_frames);
+        float u0 = (first_frame & 1) ? 0.5f : 0.0f;
+        float u1 = u0 + (last_tick - first_tick) * 0.5f;
+        draw_list->AddImage(
+                            zebra_texture,
+                            ImVec2(p0.x + first_tick * tick_width - layout.tick_offset_x, p0.y),
+                            ImVec2(p0.x + last_tick * tick_width - layout.tick_offset_x, p1.y),
+                            ImVec2(u0, 0.0f),
+                            ImVec2(u1, 1.0f),
+                            zebra_color_light);
     }
 
-    // tick marks - roughly every N pixels
-    double pixels_per_second = scale;
-    double seconds_per_tick = tick_width / pixels_per_second;
-    // ticks must use frame_rate, and must have an integer value
-    // so that the tick labels align to the human expectation of "frames"
-    int tick_duration_in_frames = ceil(seconds_per_tick / frame_rate);
-    int tick_count = ceil(width / tick_width);
-    // start_floor_time and tick_offset_x adjust the display for cases where
-    // the item's start_time is not on a whole frame boundary.
-    auto start_floor_time = otio::RationalTime(floor(start.value()), start.rate());
-    auto tick_offset = (start - start_floor_time).rescaled_to(frame_rate);
-    double tick_offset_x = tick_offset.to_seconds() * scale;
-    // last_label_end_x tracks the tail of the last label, so we can prevent
-    // overlap
-    double last_label_end_x = p0.x - text_offset.x * 2;
-    for (int tick_index = 0; tick_index < tick_count; tick_index++) {
-        auto tick_time = start.rescaled_to(frame_rate)
-        + otio::RationalTime(
-                             tick_index * tick_duration_in_frames,
-                             frame_rate)
-        - tick_offset;
-
-        double tick_x = tick_index * tick_width - tick_offset_x;
+    for (int tick_index = first_tick; tick_index < last_tick && !zebra_texture; tick_index++) {
+        double tick_x = tick_index * tick_width - layout.tick_offset_x;
         const ImVec2 tick_start = ImVec2(p0.x + tick_x, p0.y + height / 2);
         const ImVec2 tick_end = ImVec2(tick_start.x + tick_width, p1.y);
 
-        if (!ImGui::IsRectVisible(tick_start, tick_end))
-            continue;
-
-        if (seconds_per_tick >= 0.5) {
+        if (!zebra) {
             // draw thin lines at each tick
             draw_list->AddLine(
                                tick_start,
                                ImVec2(tick_start.x, tick_end.y),
                                tick_color);
         } else {
-            // once individual frames are visible, draw dark/light stripes instead
-            int frame = tick_time.to_frames();
+            // without a texture, one rect per frame
+            int frame = (int)(layout.first_tick_frame + tick_index * layout.tick_duration_in_frames);
             const ImVec2 zebra_start = ImVec2(p0.x + tick_x, p0.y);
             const ImVec2 zebra_end = ImVec2(tick_start.x + tick_width, p1.y);
             draw_list->AddRectFilled(
@@ -826,20 +1082,16 @@ void DrawTimecodeRuler(
                                      zebra_end,
                                      (frame & 1) ? zebra_color_dark : zebra_color_light);
         }
+    }
 
+    LayoutRulerLabels(layout, first_tick, last_tick);
+    for (const auto& label : layout.labels) {
+        double tick_x = label.tick_index * tick_width - layout.tick_offset_x;
         const ImVec2 tick_label_pos = ImVec2(p0.x + tick_x + text_offset.x, p0.y + text_offset.y);
-        // only draw a label when there's room for it
-        if (tick_label_pos.x > last_label_end_x + text_offset.x) {
-            std::string tick_label = FormattedStringFromTime(tick_time);
-            auto label_size = ImGui::CalcTextSize(tick_label.c_str());
-            draw_list->AddText(
-                               tick_label_pos,
-                               tick_label_color,
-                               tick_label.c_str());
-            // advance last_label_end_x so nothing will overlap with the one we just
-            // drew
-            last_label_end_x = tick_label_pos.x + label_size.x;
-        }
+        draw_list->AddText(
+                           tick_label_pos,
+                           tick_label_color,
+                           layout.label_text.c_str() + label.text_offset);
     }
 
     // For debugging, this is very helpful...
@@ -986,9 +1238,10 @@ float DrawPlayhead(
     const float arrow_height = fmin(track_height / 2, 20);
     const ImVec2 arrow_size(arrow_height, arrow_height);
 
-    std::string label_str = FormattedStringFromTime(playhead);
+    char label_str[TimeStringSize];
+    FormattedStringFromTime(label_str, sizeof(label_str), playhead);
     auto label_color = appTheme.colors[AppThemeCol_Label];
-    const ImVec2 label_size = ImGui::CalcTextSize(label_str.c_str());
+    const ImVec2 label_size = ImGui::CalcTextSize(label_str);
     const ImVec2 label_pos = ImVec2(p0.x + arrow_size.x / 2 + text_offset.x, p0.y + text_offset.y);
     const ImVec2 label_end = ImVec2(label_pos.x + label_size.x, label_pos.y + label_size.y);
 
@@ -1023,7 +1276,7 @@ float DrawPlayhead(
 
     // label
     if (draw_label) {
-        draw_list->AddText(label_pos, label_color, label_str.c_str());
+        draw_list->AddText(label_pos, label_color, label_str);
     }
 
     ImGui::EndGroup();
@@ -1049,14 +1302,17 @@ bool DrawTransportControls(TimelineProviderHarness* tp) {
         }
     }
 
-    auto start_string = FormattedStringFromTime(start);
-    auto playhead_string = FormattedStringFromTime(tp->playhead);
-    auto end_string = FormattedStringFromTime(end);
+    char start_string[TimeStringSize];
+    char playhead_string[TimeStringSize];
+    char end_string[TimeStringSize];
+    FormattedStringFromTime(start_string, sizeof(start_string), start);
+    FormattedStringFromTime(playhead_string, sizeof(playhead_string), tp->playhead);
+    FormattedStringFromTime(end_string, sizeof(end_string), end);
 
     ImGui::PushID("##TransportControls");
     ImGui::BeginGroup();
 
-    ImGui::Text("%s", start_string.c_str());
+    ImGui::Text("%s", start_string);
     ImGui::SameLine();
 
     ImGui::SetNextItemWidth(-270);
@@ -1066,13 +1322,13 @@ bool DrawTransportControls(TimelineProviderHarness* tp) {
                            &playhead_seconds,
                            playhead_limit.start_time().to_seconds(),
                            playhead_limit.end_time_exclusive().to_seconds(),
-                           playhead_string.c_str())) {
+                           playhead_string)) {
                                SeekPlayhead(playhead_seconds);
                                moved_playhead = true;
                            }
 
     ImGui::SameLine();
-    ImGui::Text("%s", end_string.c_str());
+    ImGui::Text("%s", end_string);
 
     ImGui::SameLine();
     ImGui::SetNextItemWidth(100);
@@ -1263,7 +1519,6 @@ void DrawTimeline(TimelineProviderHarness* tp) {
 
     auto playhead = tp->playhead;
     auto playhead_limit = tp->PlayheadLimit();
-    auto playhead_string = FormattedStringFromTime(playhead);
     auto start = playhead_limit.start_time();
     auto duration = playhead_limit.duration();
     auto end = playhead_limit.end_time_exclusive();
@@ -1285,6 +1540,8 @@ void DrawTimeline(TimelineProviderHarness* tp) {
     __tracks_rendered = 0;
     __items_rendered = 0;
 
+    PruneRulerLayouts();
+
     int flags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_Resizable
     | ImGuiTableFlags_NoSavedSettings
     | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollX
@@ -1354,24 +1611,26 @@ void DrawTimeline(TimelineProviderHarness* tp) {
         // now shift the origin down below the timecode track
         origin.y += tp->track_height;
 
-        // filter the video tracks
-        std::vector<TimelineNode> video_tracks;
+        // video tracks are stacked bottom up, so walk the tracks backwards
+        int index = 0;
         for (auto trackNode : tracks) {
             if (op->TrackKind(trackNode) == otio::Track::Kind::video) {
-                video_tracks.push_back(trackNode);
+                ++index;
             }
         }
 
-        int index = (int)video_tracks.size();
-        for (auto video_track = video_tracks.rbegin(); video_track != video_tracks.rend(); ++video_track) {
+        for (size_t i = tracks.size(); i-- > 0;) {
+            auto trackNode = tracks[i];
+            if (op->TrackKind(trackNode) != otio::Track::Kind::video)
+                continue;
             ImGui::TableNextRow(ImGuiTableRowFlags_None, tp->track_height);
             if (ImGui::TableNextColumn()) {
-                DrawTrackLabel(tp, *video_track, index, tp->track_height);
+                DrawTrackLabel(tp, trackNode, index, tp->track_height);
             }
             if (ImGui::TableNextColumn()) {
                 DrawTrack(
                           tp,
-                          *video_track,
+                          trackNode,
                           tp->scale,
                           origin,
                           full_width,
@@ -1414,7 +1673,6 @@ void DrawTimeline(TimelineProviderHarness* tp) {
         // do this at the very end, so the playhead can overlay everything
         ImGui::TableNextRow(ImGuiTableRowFlags_None, 1);
         ImGui::TableNextColumn();
-        // ImGui::Text("%s", playhead_string.c_str());
         ImGui::TableNextColumn();
         playhead_x = DrawPlayhead(
                                   start,
@@ -1435,9 +1693,9 @@ void DrawTimeline(TimelineProviderHarness* tp) {
             tp->scroll_to_playhead = false;
         }
 
-        // This is helpful when debugging visibility performance optimization
-        // ImGui::SetTooltip("Tracks rendered: %d\nItems rendered: %d",
-        // __tracks_rendered, __items_rendered);
+        // These show how well the visibility checks are culling
+        ProfilerCounter("Tracks rendered", __tracks_rendered);
+        ProfilerCounter("Items rendered", __items_rendered);
 
         ImGui::EndTable();
     }
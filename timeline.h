@@ -1,47 +1,390 @@
 // Timeline widget
 #ifndef RAVEN_TIMELINE_WIDGET_H
 #define RAVEN_TIMELINE_WIDGET_H
+#include <opentimelineio/effect.h>
 #include <opentimelineio/gap.h>
+#include <opentimelineio/marker.h>
 #include <opentimelineio/serializableObject.h>
+#include <opentimelineio/stack.h>
 #include <opentimelineio/timeline.h>
+#include <opentimelineio/track.h>
 #include <opentimelineio/transition.h>
 #include "timeline_provider.hpp"
+#include "thread_pool.h"
 namespace otio = opentimelineio::OPENTIMELINEIO_VERSION;
 
-#include <map>
+#include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace raven {
+// Indexes an OTIO timeline for the timeline widget.
+//
+// The root node is the timeline's top-level Stack, and every time in the
+// tables is in its coordinate space. Below it, every Composable, Marker
+// and Effect in the document gets a node, with a link to its parent. The
+// Timeline itself isn't Composable, so it sits outside of the tree as
+// node 2, which lets it be selected like everything else.
 class OTIOProvider : public TimelineProvider {
     otio::SerializableObject::Retainer<otio::Timeline> _timeline;
-    std::map<TimelineNode, otio::SerializableObject::Retainer<otio::Composable>,
-                                            cmp_TimelineNode> nodeMap;
-    std::map<TimelineNode, TimelineNode,
-                                            cmp_TimelineNode> parentMap;
-    std::map<otio::SerializableObject*, TimelineNode> _reverse;
+
+    // indexed by TimelineNode id, alongside the TimelineProvider tables
+    std::vector<otio::SerializableObject::Retainer<otio::SerializableObject>> _nodes;
+
+    std::unordered_map<otio::SerializableObject*, TimelineNode> _reverse;
     uint64_t nextId = 0;
-    
-    // Transform this range map from the context item's coodinate space
-    // into the top-level timeline's coordinate space. This compensates for
-    // any source_range offsets in intermediate levels of nesting in the
-    // composition.
-    void TransformToContextCoordinateSpace(
-                                           std::map<otio::Composable*, otio::TimeRange>& range_map,
-                                           otio::Item* context) {
-        auto zero = otio::RationalTime();
-        TimelineNode tracksNode = RootNode();
-        auto topItem = OtioFromNode(tracksNode);
-        auto top = dynamic_cast<otio::Item*>(topItem.value);
-        if (top) {
-            auto offset = context->transformed_time(zero, top);
-            for (auto& pair : range_map) {
-                auto& range = pair.second;
-                range = otio::TimeRange(range.start_time() + offset, range.duration());
+
+    // While an edit notification is being handled, the markers whose
+    // times were set or that were removed, so that only they are re-sorted
+    std::vector<TimelineNode>* _changedMarkers = nullptr;
+
+    // Documents with more nodes than this index their top-level tracks
+    // across the shared thread pool. Below it, handing the tracks out
+    // costs more than it saves.
+    static constexpr size_t parallelIndexThreshold = 10000;
+
+    void growTables(size_t count) {
+        resizeTables(count);
+        if (count > _nodes.size())
+            _nodes.resize(count);
+    }
+
+    static NodeKind KindOf(otio::SerializableObject* obj) {
+        if (dynamic_cast<otio::Gap*>(obj) != nullptr) {
+            return NodeKind::Gap;
+        }
+        else if (dynamic_cast<otio::Transition*>(obj) != nullptr) {
+            return NodeKind::Transition;
+        }
+        else if (dynamic_cast<otio::Track*>(obj) != nullptr) {
+            return NodeKind::Track;
+        }
+        else if (dynamic_cast<otio::Stack*>(obj) != nullptr) {
+            return NodeKind::Stack;
+        }
+        else if (dynamic_cast<otio::Marker*>(obj) != nullptr) {
+            return NodeKind::Marker;
+        }
+        else if (dynamic_cast<otio::Effect*>(obj) != nullptr) {
+            return NodeKind::Effect;
+        }
+        return NodeKind::General;
+    }
+
+    // the number of nodes a composable and everything below it needs
+    static size_t CountNodes(otio::Composable* comp) {
+        size_t count = 1;
+        if (const auto& item = dynamic_cast<otio::Item*>(comp)) {
+            count += item->markers().size() + item->effects().size();
+        }
+        if (const auto& composition = dynamic_cast<otio::Composition*>(comp)) {
+            for (const auto& child : composition->children()) {
+                count += CountNodes(child.value);
             }
         }
+        return count;
     }
-    
+
+    // Fill in the tables for one node, whose id is already allocated. This
+    // doesn't touch _reverse or the string store, so that subtrees can be
+    // indexed concurrently; RegisterReverse and RegisterNames fill those
+    // in afterwards.
+    void SetNode(TimelineNode node,
+                 otio::SerializableObject* obj,
+                 TimelineNode parent) {
+        _nodes[node.id] = obj;
+        _parents[node.id] = parent;
+        _kinds[node.id] = KindOf(obj);
+    }
+
+    // Index a composable and everything below it, allocating ids from
+    // *next. The tables must already be large enough.
+    TimelineNode IndexSubtree(otio::Composable* comp,
+                              TimelineNode parent,
+                              uint64_t* next) {
+        auto node = (TimelineNode){(*next)++};
+        SetNode(node, comp, parent);
+
+        if (const auto& item = dynamic_cast<otio::Item*>(comp)) {
+            for (const auto& marker : item->markers()) {
+                auto markerNode = (TimelineNode){(*next)++};
+                SetNode(markerNode, marker.value, node);
+                _markers[node.id].push_back(markerNode);
+            }
+            for (const auto& effect : item->effects()) {
+                auto effectNode = (TimelineNode){(*next)++};
+                SetNode(effectNode, effect.value, node);
+                _effects[node.id].push_back(effectNode);
+            }
+        }
+
+        if (const auto& composition = dynamic_cast<otio::Composition*>(comp)) {
+            // a track's children follow one another; a stack's all start together
+            auto& starts = dynamic_cast<otio::Track*>(comp) ? _seqStarts[node.id]
+                                                            : _syncStarts[node.id];
+            starts.reserve(composition->children().size());
+            for (const auto& child : composition->children()) {
+                starts.push_back(IndexSubtree(child.value, node, next));
+            }
+        }
+        return node;
+    }
+
+    void RegisterReverse(uint64_t first, uint64_t last) {
+        for (uint64_t id = first; id < last; ++id) {
+            if (_nodes[id].value) {
+                _reverse[_nodes[id].value] = (TimelineNode){id};
+            }
+        }
+    }
+
+    void RegisterNames(uint64_t first, uint64_t last) {
+        for (uint64_t id = first; id < last; ++id) {
+            auto obj = _nodes[id].value;
+            if (const auto& named = dynamic_cast<otio::SerializableObjectWithMetadata*>(obj)) {
+                _names[id] = _strings.Intern(named->name());
+            }
+            if (const auto& track = dynamic_cast<otio::Track*>(obj)) {
+                _trackKinds[id] = _strings.Intern(track->kind());
+            }
+        }
+    }
+
+    // Point a node, and the nodes the tables list below it, at obj and the
+    // objects below it, as long as the two have the same shape
+    bool AttachNode(TimelineNode node, otio::SerializableObject* obj) {
+        if (!validNode(node) || _nodes[node.id].value || KindOf(obj) != _kinds[node.id])
+            return false;
+        _nodes[node.id] = obj;
+        if (const auto& item = dynamic_cast<otio::Item*>(obj)) {
+            if (!AttachNodeList(_markers[node.id], item->markers())
+                || !AttachNodeList(_effects[node.id], item->effects()))
+                return false;
+        }
+        if (const auto& composition = dynamic_cast<otio::Composition*>(obj)) {
+            const auto& starts = dynamic_cast<otio::Track*>(obj) ? _seqStarts[node.id]
+                                                                : _syncStarts[node.id];
+            if (!AttachNodeList(starts, composition->children()))
+                return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool AttachNodeList(const std::vector<TimelineNode>& list,
+                        const std::vector<otio::SerializableObject::Retainer<T>>& objects) {
+        if (list.size() != objects.size())
+            return false;
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (!AttachNode(list[i], objects[i].value))
+                return false;
+        }
+        return true;
+    }
+
+    // index a new subtree at the end of the tables
+    TimelineNode AppendSubtree(otio::Composable* comp, TimelineNode parent) {
+        uint64_t first = nextId;
+        nextId += CountNodes(comp);
+        growTables(nextId);
+        uint64_t next = first;
+        auto node = IndexSubtree(comp, parent, &next);
+        RegisterReverse(first, nextId);
+        RegisterNames(first, nextId);
+        return node;
+    }
+
+    TimelineNode AppendNode(otio::SerializableObject* obj, TimelineNode parent) {
+        auto node = (TimelineNode){nextId++};
+        growTables(nextId);
+        SetNode(node, obj, parent);
+        RegisterReverse(node.id, node.id + 1);
+        RegisterNames(node.id, node.id + 1);
+        return node;
+    }
+
+    // Given a node's own range, compute the ranges of everything below it.
+    // An item's children, markers and effects are all in the item's own
+    // coordinate space, which lines up with the root's at the item's
+    // trimmed start, so a single offset per item carries them all across.
+    void IndexTimes(TimelineNode node) {
+        auto item = dynamic_cast<otio::Item*>(_nodes[node.id].value);
+        if (!item)
+            return;
+
+        const auto range = _times[node.id];
+        const auto offset = range.start_time() - item->trimmed_range().start_time();
+        IndexAnnotationTimes(node, offset);
+
+        auto composition = dynamic_cast<otio::Composition*>(item);
+        if (!composition)
+            return;
+
+        bool is_track = dynamic_cast<otio::Track*>(composition) != nullptr;
+        const auto& starts = is_track ? _seqStarts[node.id] : _syncStarts[node.id];
+        auto ranges = composition->range_of_all_children();
+        for (auto child : starts) {
+            auto it = ranges.find(dynamic_cast<otio::Composable*>(_nodes[child.id].value));
+            if (it == ranges.end())
+                continue;
+            _times[child.id] = otio::TimeRange(it->second.start_time() + offset,
+                                               it->second.duration());
+            IndexTimes(child);
+        }
+        if (is_track) {
+            buildSeqIndex(node);
+        }
+    }
+
+    void IndexAnnotationTimes(TimelineNode node, otio::RationalTime offset) {
+        for (auto markerNode : _markers[node.id]) {
+            auto marker = dynamic_cast<otio::Marker*>(_nodes[markerNode.id].value);
+            auto marked_range = marker->marked_range();
+            _times[markerNode.id] = otio::TimeRange(marked_range.start_time() + offset,
+                                                    marked_range.duration());
+            if (_changedMarkers)
+                _changedMarkers->push_back(markerNode);
+        }
+        for (auto effectNode : _effects[node.id]) {
+            _times[effectNode.id] = _times[node.id];
+        }
+    }
+
+    void RetimeAnnotations(TimelineNode node) {
+        if (auto item = dynamic_cast<otio::Item*>(_nodes[node.id].value)) {
+            IndexAnnotationTimes(node, _times[node.id].start_time()
+                                       - item->trimmed_range().start_time());
+        }
+    }
+
+    // The range of a top-level track doesn't depend on its siblings, so a
+    // timing change anywhere below one only needs that track re-timed.
+    void Retime(TimelineNode node) {
+        auto root = RootNodeId();
+        auto kind = _kinds[node.id];
+        if (kind == NodeKind::Marker || kind == NodeKind::Effect) {
+            RetimeAnnotations(_parents[node.id]);
+            return;
+        }
+        if (node == root) {
+            _times[root.id] = _timeline->tracks()->trimmed_range();
+            IndexTimes(root);
+            return;
+        }
+        while (node != TimelineNodeNull() && _parents[node.id] != root) {
+            node = _parents[node.id];
+        }
+        if (node == TimelineNodeNull())
+            return;
+        auto child = dynamic_cast<otio::Composable*>(_nodes[node.id].value);
+        _times[node.id] = _timeline->tracks()->range_of_child(child);
+        IndexTimes(node);
+    }
+
+    // forget a node and everything below it. Its id is not reused, so ids
+    // held for other nodes stay valid.
+    void RemoveNode(TimelineNode node) {
+        if (_changedMarkers && _kinds[node.id] == NodeKind::Marker)
+            _changedMarkers->push_back(node);
+        for (auto child : _seqStarts[node.id]) {
+            RemoveNode(child);
+        }
+        for (auto child : _syncStarts[node.id]) {
+            RemoveNode(child);
+        }
+        for (auto child : _markers[node.id]) {
+            RemoveNode(child);
+        }
+        for (auto child : _effects[node.id]) {
+            RemoveNode(child);
+        }
+        auto it = _reverse.find(_nodes[node.id].value);
+        if (it != _reverse.end() && it->second == node) {
+            _reverse.erase(it);
+        }
+        _nodes[node.id] = nullptr;
+        _parents[node.id] = TimelineNodeNull();
+        _syncStarts[node.id].clear();
+        _seqStarts[node.id].clear();
+        _markers[node.id].clear();
+        _effects[node.id].clear();
+        _seqMinStarts[node.id].clear();
+        _seqMaxEnds[node.id].clear();
+        _seqLods[node.id].clear();
+        _times[node.id] = TimeRange();
+        _names[node.id] = 0;
+        _trackKinds[node.id] = 0;
+        _kinds[node.id] = NodeKind::General;
+    }
+
+    // run an edit to the index, then re-sort the markers it touched
+    template<typename EditFn>
+    void UpdateMarkers(EditFn edit) {
+        std::vector<TimelineNode> changed;
+        _changedMarkers = &changed;
+        edit();
+        _changedMarkers = nullptr;
+        updateMarkerOrder(std::move(changed));
+    }
+
+    // Bring a list of child nodes up to date with the objects it mirrors,
+    // keeping the ids of the children that are still there.
+    template<typename T, typename AddFn, typename StillThereFn>
+    void SyncNodeList(std::vector<TimelineNode>& list,
+                      const std::vector<otio::SerializableObject::Retainer<T>>& objects,
+                      TimelineNode parent,
+                      AddFn add,
+                      StillThereFn still_there) {
+        std::vector<TimelineNode> previous;
+        previous.swap(list);
+        list.reserve(objects.size());
+        for (const auto& obj : objects) {
+            TimelineNode node = NodeFromOtio(obj.value);
+            if (node == TimelineNodeNull() || _parents[node.id] != parent) {
+                node = add(obj.value);
+            }
+            list.push_back(node);
+        }
+        for (auto node : previous) {
+            auto obj = _nodes[node.id].value;
+            if (obj && !still_there(obj)) {
+                RemoveNode(node);
+            }
+        }
+    }
+
+    void SyncChildren(TimelineNode node) {
+        auto composition = dynamic_cast<otio::Composition*>(_nodes[node.id].value);
+        if (!composition)
+            return;
+        auto& starts = dynamic_cast<otio::Track*>(composition) ? _seqStarts[node.id]
+                                                               : _syncStarts[node.id];
+        SyncNodeList(starts, composition->children(), node,
+                     [&](otio::Composable* child) { return AppendSubtree(child, node); },
+                     [&](otio::SerializableObject* child) {
+                         return dynamic_cast<otio::Composable*>(child)->parent() == composition;
+                     });
+    }
+
+    void SyncAnnotations(TimelineNode node) {
+        auto item = dynamic_cast<otio::Item*>(_nodes[node.id].value);
+        if (!item)
+            return;
+        const auto& markers = item->markers();
+        SyncNodeList(_markers[node.id], markers, node,
+                     [&](otio::Marker* marker) { return AppendNode(marker, node); },
+                     [&](otio::SerializableObject* obj) {
+                         return std::find(markers.begin(), markers.end(), obj) != markers.end();
+                     });
+        const auto& effects = item->effects();
+        SyncNodeList(_effects[node.id], effects, node,
+                     [&](otio::Effect* effect) { return AppendNode(effect, node); },
+                     [&](otio::SerializableObject* obj) {
+                         return std::find(effects.begin(), effects.end(), obj) != effects.end();
+                     });
+    }
+
 public:
     OTIOProvider() = default;
     virtual ~OTIOProvider() = default;
@@ -54,90 +397,195 @@ public:
     
     void SetTimeline(otio::SerializableObject::Retainer<otio::Timeline> t) {
         _timeline = t;
-        nodeMap.clear();
-        clearMaps();
+        _nodes.clear();
+        _reverse.clear();
+        clearTables();
+        nextId = 0;
         if (t.value == nullptr)
             return;
-        
-        // add the root
+
         otio::Stack* stack = t->tracks();
-        nodeMap[RootNodeId()] = otio::dynamic_retainer_cast<otio::Composable>(t);
-        _syncStarts[RootNodeId()] = std::vector<TimelineNode>();
-        
-        // encode the tracks of the timeline's stack as sync starts on the root.
-        auto start_it = _syncStarts.find(RootNodeId());
-        nextId = 3;
-        std::vector<otio::SerializableObject::Retainer<otio::Composable>> const& tracks = stack->children();
-        for (auto trackItem : tracks) {
-            otio::SerializableObject::Retainer<otio::Composable> track = otio::dynamic_retainer_cast<otio::Composable>(trackItem); // Composable to Item
-            nodeMap[(TimelineNode){nextId}] = track;
-            auto trackNode = (TimelineNode){nextId};
-            _reverse[trackItem.value] = trackNode;
-            start_it->second.push_back(trackNode); // register the synchronous start
-            _seqStarts[trackNode] = std::vector<TimelineNode>();
-            _names[trackNode] = track->name();
-            _trackKinds[trackNode] = dynamic_cast<otio::Track*>(track.value)->kind();
-            auto seq_it = _seqStarts.find(trackNode);
-            ++nextId;
-            
-            otio::SerializableObject::Retainer<otio::Track> otrack = otio::dynamic_retainer_cast<otio::Track>(trackItem); // Composable to Item
-            for (const auto& child : otrack->children()) {
-                if (const auto& item = dynamic_cast<otio::Composable*>(child.value)) {
-                    TimelineNode itemNode = (TimelineNode){nextId};
-                    parentMap[itemNode] = trackNode;
-                    nodeMap[itemNode] = item;
-                    _reverse[item] = itemNode;
-                    _names[itemNode] = item->name();
-                    seq_it->second.push_back(itemNode); // register the sequential starts
-                    
-                    if (dynamic_cast<otio::Gap*>(item) != nullptr) {
-                        _kinds[itemNode] = NodeKind::Gap;
-                    }
-                    else if (dynamic_cast<otio::Transition*>(item) != nullptr) {
-                        _kinds[itemNode] = NodeKind::Transition;
-                    }
-                    else {
-                        _kinds[itemNode] = NodeKind::General;
+        const auto& tracks = stack->children();
+
+        // Allocate every id up front, so each top-level track owns a known
+        // range of them and can be indexed independently of the others.
+        std::vector<uint64_t> firsts(tracks.size());
+        uint64_t count = 3 + stack->markers().size() + stack->effects().size();
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            firsts[i] = count;
+            count += CountNodes(tracks[i].value);
+        }
+        growTables(count);
+        nextId = count;
+        _reverse.reserve(count);
+
+        // The root and the timeline, then the root's own markers and effects
+        auto root = RootNodeId();
+        SetNode(root, stack, TimelineNodeNull());
+        SetNode((TimelineNode){2}, t.value, TimelineNodeNull());
+        uint64_t next = 3;
+        for (const auto& marker : stack->markers()) {
+            auto markerNode = (TimelineNode){next++};
+            SetNode(markerNode, marker.value, root);
+            _markers[root.id].push_back(markerNode);
+        }
+        for (const auto& effect : stack->effects()) {
+            auto effectNode = (TimelineNode){next++};
+            SetNode(effectNode, effect.value, root);
+            _effects[root.id].push_back(effectNode);
+        }
+
+        // The tracks, as synchronous starts of the root
+        _syncStarts[root.id].resize(tracks.size());
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            _syncStarts[root.id][i] = (TimelineNode){firsts[i]};
+        }
+        // Times flow down from the root, so they follow the same split
+        _times[root.id] = stack->trimmed_range();
+        auto track_ranges = stack->range_of_all_children();
+        auto index_track = [&](size_t i) {
+            uint64_t track_next = firsts[i];
+            auto trackNode = IndexSubtree(tracks[i].value, root, &track_next);
+            _times[trackNode.id] = track_ranges.at(tracks[i].value);
+            IndexTimes(trackNode);
+        };
+        if (count >= parallelIndexThreshold && tracks.size() > 1) {
+            // largest first, so a long track isn't left to run on its own
+            // at the end while the other workers sit idle
+            std::vector<size_t> order(tracks.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            auto track_size = [&](size_t i) {
+                return (i + 1 < firsts.size() ? firsts[i + 1] : count) - firsts[i];
+            };
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return track_size(a) > track_size(b);
+            });
+            ThreadPool::Shared().ParallelFor(order.size(), [&](size_t i) {
+                index_track(order[i]);
+            });
+        }
+        else {
+            for (size_t i = 0; i < tracks.size(); ++i) {
+                index_track(i);
+            }
+        }
+        IndexAnnotationTimes(root, otio::RationalTime());
+        RegisterReverse(1, count);
+        RegisterNames(1, count);
+        buildMarkerOrder();
+    }
+
+    // Adopt tables that were filled in elsewhere, as SetTimeline would have
+    // filled them for t, e.g. by TimelineCache. Only the objects are looked
+    // up, and checked against the tables; times aren't recomputed. Returns
+    // false if t doesn't match, in which case call SetTimeline instead.
+    bool AttachTimeline(otio::SerializableObject::Retainer<otio::Timeline> t) {
+        _timeline = t;
+        _nodes.clear();
+        _reverse.clear();
+        nextId = _kinds.size();
+        if (t.value == nullptr || nextId < 3)
+            return false;
+        _nodes.resize(nextId);
+        if (!AttachNode(RootNodeId(), t->tracks())
+            || !AttachNode((TimelineNode){2}, t.value))
+            return false;
+        // ids are dense, so every one of them must have been reached
+        for (uint64_t id = 1; id < nextId; ++id) {
+            if (!_nodes[id].value)
+                return false;
+        }
+
+        for (uint64_t id = 1; id < nextId; ++id) {
+            if (_kinds[id] == NodeKind::Track)
+                buildSeqIndex((TimelineNode){id});
+        }
+        _reverse.reserve(nextId);
+        RegisterReverse(1, nextId);
+        buildMarkerOrder();
+        return true;
+    }
+
+    // Edit notifications. Call these after changing the OTIO graph, so that
+    // only the affected part of the index is rebuilt. Ids of nodes that
+    // weren't touched by the edit are kept.
+
+    // children were added to, or removed from, a composition
+    void NotifyChildrenChanged(otio::Composition* comp) {
+        TimelineNode node = NodeFromOtio(comp);
+        if (node == TimelineNodeNull())
+            return;
+        UpdateMarkers([&]() {
+            uint64_t firstNew = nextId;
+            SyncChildren(node);
+            if (node == RootNodeId()) {
+                // top-level tracks don't move each other, only new ones need times
+                for (auto track : _syncStarts[node.id]) {
+                    if (track.id >= firstNew) {
+                        Retime(track);
                     }
-                    
-                    ++nextId;
                 }
             }
-            
-            // compute and cache the times for all the children
-            auto times = otrack->range_of_all_children();
-            TransformToContextCoordinateSpace(times, otrack);
-            for (auto time : times) {
-                auto it = _reverse.find(time.first);
-                if (it != _reverse.end()) {
-                    _times[it->second] = time.second;
-                }
+            else {
+                Retime(node);
             }
+        });
+    }
+
+    // markers or effects were added to, or removed from, an item
+    void NotifyAnnotationsChanged(otio::Item* item) {
+        TimelineNode node = NodeFromOtio(item);
+        if (node == TimelineNodeNull())
+            return;
+        UpdateMarkers([&]() {
+            SyncAnnotations(node);
+            RetimeAnnotations(node);
+        });
+    }
+
+    // the name of an object changed
+    void NotifyNameChanged(otio::SerializableObjectWithMetadata* obj) {
+        TimelineNode node = NodeFromOtio(obj);
+        if (node != TimelineNodeNull()) {
+            _names[node.id] = _strings.Intern(obj->name());
+            // the markers list shows, sorts and filters by marker names
+            // and by the names of the items they're on
+            if (_kinds[node.id] == NodeKind::Marker || !_markers[node.id].empty())
+                _markerRevision = nextRevision();
         }
     }
+
+    // the range or offsets of an object changed, which moves it and
+    // everything after it in its track
+    void NotifyTimingChanged(otio::SerializableObject* obj) {
+        TimelineNode node = NodeFromOtio(obj);
+        if (node == TimelineNodeNull())
+            return;
+        UpdateMarkers([&]() { Retime(node); });
+    }
     
     std::vector<std::string> NodeKindNames() const override {
         return {};
     }
     
     TimelineNode RootNode() const override {
-        auto it = nodeMap.find(RootNodeId());
-        if (it == nodeMap.end()) {
+        if (_timeline.value == nullptr) {
             return TimelineNodeNull();
         }
-        return it->first;
+        return RootNodeId();
     }
     
     otio::SerializableObject::Retainer<otio::Timeline> OtioTimeline() {
         return _timeline;
     }
     
-    otio::SerializableObject::Retainer<otio::Composable> OtioFromNode(TimelineNode n) {
-        auto it = nodeMap.find(n);
-        if (it == nodeMap.end()) {
+    otio::SerializableObject::Retainer<otio::SerializableObject> OtioFromNode(TimelineNode n) {
+        if (n.id >= _nodes.size()) {
             return {};
         }
-        return it->second;
+        return _nodes[n.id];
     }
     
     TimelineNode NodeFromOtio(otio::SerializableObject* i) {
@@ -149,11 +597,10 @@ public:
     }
     
     uint64_t StationaryId(TimelineNode n) const override {
-        auto it = nodeMap.find(n);
-        if (it == nodeMap.end()) {
+        if (n.id >= _nodes.size()) {
             return {};
         }
-        return static_cast<uint64_t>(static_cast<uintptr_t>(it->second));
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(_nodes[n.id].value));
     }
 };
 
@@ -0,0 +1,276 @@
+// Sidecar cache of a timeline's index
+
+#include "timeline_cache.h"
+#include "mapped_file.h"
+#include "app.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace raven {
+
+using TimeRange = opentime::OPENTIME_VERSION::TimeRange;
+using RationalTime = opentime::OPENTIME_VERSION::RationalTime;
+
+static const char timeline_cache_magic[8] = { 'R', 'A', 'V', 'E', 'N', 'I', 'D', 'X' };
+static const uint32_t timeline_cache_version = 1;
+// written as is, so a cache from a machine with the other byte order
+// reads back differently and is ignored
+static const uint32_t timeline_cache_byte_order = 0x01020304;
+
+struct TimelineCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t node_count;
+};
+
+TimelineCacheKey TimelineCacheKeyFor(const std::string& path, const char* data, size_t size) {
+    TimelineCacheKey key;
+    key.size = size;
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0)
+        key.mtime = (int64_t)info.st_mtime;
+
+    // A word at a time, since this runs over the whole file on every load
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = size * multiplier;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail = 0;
+    if (i < size)
+        memcpy(&tail, data + i, size - i);
+    hash = (hash ^ tail) * multiplier;
+    key.hash = hash ^ (hash >> 32);
+    return key;
+}
+
+std::string TimelineCachePath(const std::string& path) {
+    return path + ".ravencache";
+}
+
+// Builds the cache in memory, padding every array to 8 bytes
+struct TimelineCacheWriter {
+    std::string buffer;
+
+    void Append(const void* data, size_t size) {
+        buffer.append((const char*)data, size);
+        buffer.resize((buffer.size() + 7) & ~(size_t)7, '\0');
+    }
+    template<typename T>
+    void AppendArray(const std::vector<T>& values) {
+        Append(values.data(), values.size() * sizeof(T));
+    }
+
+    // each node's string in full, so the file doesn't depend on handles
+    void AppendStrings(const std::vector<uint32_t>& handles, const StringStore& strings) {
+        std::vector<uint64_t> offsets;
+        offsets.reserve(handles.size() + 1);
+        uint64_t offset = 0;
+        for (auto handle : handles) {
+            offsets.push_back(offset);
+            offset += strings.View(handle).size();
+        }
+        offsets.push_back(offset);
+        AppendArray(offsets);
+        std::string text;
+        text.reserve(offset);
+        for (auto handle : handles) {
+            text.append(strings.View(handle));
+        }
+        Append(text.data(), text.size());
+    }
+
+    void AppendLists(const std::vector<std::vector<TimelineNode>>& lists) {
+        std::vector<uint64_t> offsets;
+        offsets.reserve(lists.size() + 1);
+        uint64_t offset = 0;
+        for (const auto& list : lists) {
+            offsets.push_back(offset);
+            offset += list.size();
+        }
+        offsets.push_back(offset);
+        AppendArray(offsets);
+        std::vector<uint64_t> ids;
+        ids.reserve(offset);
+        for (const auto& list : lists) {
+            for (auto node : list) {
+                ids.push_back(node.id);
+            }
+        }
+        AppendArray(ids);
+    }
+};
+
+// Walks the arrays of a mapped cache, failing on anything that would run
+// off the end of it
+struct TimelineCacheReader {
+    const char* data;
+    size_t size;
+    size_t offset = 0;
+
+    template<typename T>
+    const T* Take(size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (count > size / sizeof(T) || bytes > size - offset)
+            return nullptr;
+        const T* values = (const T*)(data + offset);
+        offset = std::min(size, (offset + bytes + 7) & ~(size_t)7);
+        return values;
+    }
+
+    bool TakeStrings(size_t count, std::vector<uint32_t>* handles, StringStore* strings) {
+        const uint64_t* offsets = Take<uint64_t>(count + 1);
+        if (!offsets)
+            return false;
+        const char* text = Take<char>(offsets[count]);
+        if (!text)
+            return false;
+        for (size_t i = 0; i < count; ++i) {
+            if (offsets[i] > offsets[i + 1] || offsets[i + 1] > offsets[count])
+                return false;
+            (*handles)[i] = strings->Intern(
+                std::string_view(text + offsets[i], offsets[i + 1] - offsets[i]));
+        }
+        return true;
+    }
+
+    bool TakeLists(size_t count, std::vector<std::vector<TimelineNode>>* lists) {
+        const uint64_t* offsets = Take<uint64_t>(count + 1);
+        if (!offsets)
+            return false;
+        const uint64_t* ids = Take<uint64_t>(offsets[count]);
+        if (!ids)
+            return false;
+        for (size_t i = 0; i < count; ++i) {
+            if (offsets[i] > offsets[i + 1] || offsets[i + 1] > offsets[count])
+                return false;
+            auto& list = (*lists)[i];
+            list.resize(offsets[i + 1] - offsets[i]);
+            for (size_t j = 0; j < list.size(); ++j) {
+                list[j] = (TimelineNode){ ids[offsets[i] + j] };
+            }
+        }
+        return true;
+    }
+};
+
+bool TimelineCache::Write(const std::string& cache_path,
+                          const TimelineCacheKey& key,
+                          const OTIOProvider& provider) {
+    size_t count = provider._kinds.size();
+
+    TimelineCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, timeline_cache_magic, sizeof(header.magic));
+    header.version = timeline_cache_version;
+    header.byte_order = timeline_cache_byte_order;
+    header.source_size = key.size;
+    header.source_mtime = key.mtime;
+    header.source_hash = key.hash;
+    header.node_count = count;
+
+    std::vector<double> times;
+    times.reserve(count * 4);
+    for (const auto& range : provider._times) {
+        times.push_back(range.start_time().value());
+        times.push_back(range.start_time().rate());
+        times.push_back(range.duration().value());
+        times.push_back(range.duration().rate());
+    }
+    std::vector<uint32_t> kinds(provider._kinds.begin(), provider._kinds.end());
+    std::vector<uint64_t> parents;
+    parents.reserve(count);
+    for (auto parent : provider._parents) {
+        parents.push_back(parent.id);
+    }
+
+    TimelineCacheWriter writer;
+    writer.Append(&header, sizeof(header));
+    writer.AppendArray(times);
+    writer.AppendArray(kinds);
+    writer.AppendArray(parents);
+    writer.AppendStrings(provider._names, provider._strings);
+    writer.AppendStrings(provider._trackKinds, provider._strings);
+    writer.AppendLists(provider._seqStarts);
+    writer.AppendLists(provider._syncStarts);
+    writer.AppendLists(provider._markers);
+    writer.AppendLists(provider._effects);
+
+    // Write beside the cache and then swap it in, so that a reader never
+    // sees half a file
+    std::string temp_path = cache_path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    bool ok = fwrite(writer.buffer.data(), 1, writer.buffer.size(), file) == writer.buffer.size();
+    ok = fclose(file) == 0 && ok;
+    if (ok)
+        ok = RenameOver(temp_path, cache_path);
+    if (!ok)
+        remove(temp_path.c_str());
+    return ok;
+}
+
+bool TimelineCache::Read(const std::string& cache_path,
+                         const TimelineCacheKey& key,
+                         otio::SerializableObject::Retainer<otio::Timeline> timeline,
+                         OTIOProvider* provider) {
+    MappedFile file;
+    if (!file.Open(cache_path))
+        return false;
+
+    TimelineCacheReader reader = { file.data(), file.size() };
+    const TimelineCacheHeader* header = reader.Take<TimelineCacheHeader>(1);
+    if (!header
+        || memcmp(header->magic, timeline_cache_magic, sizeof(header->magic)) != 0
+        || header->version != timeline_cache_version
+        || header->byte_order != timeline_cache_byte_order
+        || header->source_size != key.size
+        || header->source_mtime != key.mtime
+        || header->source_hash != key.hash) {
+        return false;
+    }
+
+    size_t count = header->node_count;
+    const double* times = reader.Take<double>(count * 4);
+    const uint32_t* kinds = reader.Take<uint32_t>(count);
+    const uint64_t* parents = reader.Take<uint64_t>(count);
+    if (!times || !kinds || !parents)
+        return false;
+
+    provider->clearTables();
+    provider->resizeTables(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (kinds[i] > TimelineProvider::NodeKind::Effect || parents[i] >= count)
+            return false;
+        provider->_times[i] = TimeRange(RationalTime(times[i * 4 + 0], times[i * 4 + 1]),
+                                        RationalTime(times[i * 4 + 2], times[i * 4 + 3]));
+        provider->_kinds[i] = (TimelineProvider::NodeKind)kinds[i];
+        provider->_parents[i] = (TimelineNode){ parents[i] };
+    }
+    if (!reader.TakeStrings(count, &provider->_names, &provider->_strings)
+        || !reader.TakeStrings(count, &provider->_trackKinds, &provider->_strings)
+        || !reader.TakeLists(count, &provider->_seqStarts)
+        || !reader.TakeLists(count, &provider->_syncStarts)
+        || !reader.TakeLists(count, &provider->_markers)
+        || !reader.TakeLists(count, &provider->_effects)) {
+        return false;
+    }
+
+    return provider->AttachTimeline(timeline);
+}
+
+} // raven
@@ -0,0 +1,51 @@
+// Sidecar cache of a timeline's index
+#ifndef RAVEN_TIMELINE_CACHE_H
+#define RAVEN_TIMELINE_CACHE_H
+
+#include "timeline.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace raven {
+
+// Identifies the exact contents of a source file. The size and
+// modification time catch most changes cheaply; the hash catches the rest.
+struct TimelineCacheKey {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+};
+
+// The key for the file at path, whose contents have already been read
+TimelineCacheKey TimelineCacheKeyFor(const std::string& path, const char* data, size_t size);
+
+// The cache for a file sits beside it, as file.otio.ravencache
+std::string TimelineCachePath(const std::string& path);
+
+// Saves and restores the tables an OTIOProvider builds in SetTimeline, so
+// that reopening an unchanged file can skip computing the time of every
+// node. The file is a header followed by flat, 8 byte aligned arrays, one
+// per table, and is read in place from a memory mapping.
+//
+// The OTIO objects themselves still come from the parsed .otio file. A
+// cache only describes the tables, and Read checks the timeline's
+// structure against them as it attaches each object to its node.
+class TimelineCache {
+public:
+    static bool Write(const std::string& cache_path,
+                      const TimelineCacheKey& key,
+                      const OTIOProvider& provider);
+
+    // Returns false, leaving the provider to be rebuilt with SetTimeline,
+    // if there's no cache for key or it doesn't match the timeline.
+    static bool Read(const std::string& cache_path,
+                     const TimelineCacheKey& key,
+                     otio::SerializableObject::Retainer<otio::Timeline> timeline,
+                     OTIOProvider* provider);
+};
+
+} // raven
+
+#endif
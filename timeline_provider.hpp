@@ -10,6 +10,16 @@
 
 #include <opentime/timeRange.h>
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace raven {
 
 struct TimelineNode {
@@ -30,97 +40,486 @@ inline bool operator!= (const TimelineNode& a, const TimelineNode& b) {
     return !(a == b);
 }
 
+// A non-owning view of a run of nodes held by a provider. It stays valid
+// until the provider next changes, so take one per frame rather than
+// keeping it around.
+class NodeSpan {
+public:
+    NodeSpan() = default;
+    NodeSpan(const TimelineNode* data, size_t size)
+    : _data(data), _size(size) {}
+    NodeSpan(const std::vector<TimelineNode>& nodes)
+    : _data(nodes.data()), _size(nodes.size()) {}
+
+    const TimelineNode* begin() const { return _data; }
+    const TimelineNode* end() const { return _data + _size; }
+    const TimelineNode* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const TimelineNode& operator[](size_t i) const { return _data[i]; }
+
+private:
+    const TimelineNode* _data = nullptr;
+    size_t _size = 0;
+};
+
 constexpr inline TimelineNode TimelineNodeNull() { return { 0 }; }
 constexpr inline TimelineNode RootNodeId() { return (TimelineNode){1}; }
 
+// Strings stored once each and referred to by 32-bit handles, so that
+// the thousands of clips sharing a reel-style name share one copy of it.
+// Strings are never moved or freed until Clear(), so views stay valid,
+// and each one is followed by a NUL, so data() is also a C string.
+// Handle 0 is the empty string. Not thread safe.
+class StringStore {
+public:
+    StringStore() { Clear(); }
+
+    void Clear() {
+        _chunks.clear();
+        _chunk = nullptr;
+        _chunkUsed = 0;
+        _views.assign(1, std::string_view("", 0));
+        _handles.clear();
+    }
+
+    uint32_t Intern(std::string_view s) {
+        if (s.empty())
+            return 0;
+        auto it = _handles.find(s);
+        if (it != _handles.end())
+            return it->second;
+        auto stored = Store(s);
+        uint32_t handle = (uint32_t)_views.size();
+        _views.push_back(stored);
+        _handles.emplace(stored, handle);
+        return handle;
+    }
+
+    std::string_view View(uint32_t handle) const {
+        return handle < _views.size() ? _views[handle] : _views[0];
+    }
+
+private:
+    static constexpr size_t chunkSize = 64 * 1024;
+
+    std::string_view Store(std::string_view s) {
+        size_t size = s.size() + 1;
+        char* data;
+        if (size > chunkSize / 4) {
+            // large strings get a block of their own
+            _chunks.emplace_back(new char[size]);
+            data = _chunks.back().get();
+        } else {
+            if (!_chunk || _chunkUsed + size > chunkSize) {
+                _chunks.emplace_back(new char[chunkSize]);
+                _chunk = _chunks.back().get();
+                _chunkUsed = 0;
+            }
+            data = _chunk + _chunkUsed;
+            _chunkUsed += size;
+        }
+        std::copy(s.begin(), s.end(), data);
+        data[s.size()] = '\0';
+        return std::string_view(data, s.size());
+    }
+
+    std::vector<std::unique_ptr<char[]>> _chunks;
+    char* _chunk = nullptr;
+    size_t _chunkUsed = 0;
+    std::vector<std::string_view> _views;
+    std::unordered_map<std::string_view, uint32_t> _handles;
+};
+
 class TimelineProvider {
 public:
     enum NodeKind {
-        Track, General, Gap, Transition
+        Track, General, Gap, Transition, Stack, Marker, Effect
     };
     
     using TimeRange = opentime::OPENTIME_VERSION::TimeRange;
     using RationalTime = opentime::OPENTIME_VERSION::RationalTime;
 
+    // One level of a sequence's level-of-detail pyramid. Runs of children
+    // that are each shorter than the level's resolution, and no further
+    // apart than it, are merged into a single span; every other child is
+    // a span of its own. Times are in seconds.
+    struct LodLevel {
+        double resolution = 0;
+        std::vector<uint32_t> first;    // index into SeqStarts of the span's first child
+        std::vector<uint32_t> count;    // number of children in the span
+        std::vector<double> starts;
+        std::vector<double> ends;
+        std::vector<double> covered;    // seconds covered by children that aren't gaps
+        std::vector<double> minStarts;  // interval index, as for SeqStartsInRange
+        std::vector<double> maxEnds;
+
+        size_t size() const { return first.size(); }
+
+        // the half-open range of spans that may overlap the window
+        std::pair<size_t, size_t> SpansInRange(double start_seconds, double end_seconds) const {
+            size_t lo = std::upper_bound(maxEnds.begin(), maxEnds.end(), start_seconds)
+                        - maxEnds.begin();
+            size_t hi = std::upper_bound(minStarts.begin(), minStarts.end(), end_seconds)
+                        - minStarts.begin();
+            return { lo, std::max(lo, hi) };
+        }
+    };
+
+    // the finest level of detail; each coarser level doubles it
+    static constexpr double lodBaseResolution = 1.0 / 1024.0;
+
 protected:
-    std::string nullName;
-    std::map<TimelineNode, std::vector<TimelineNode>, cmp_TimelineNode> _syncStarts;
-    std::map<TimelineNode, std::vector<TimelineNode>, cmp_TimelineNode> _seqStarts;
-    std::map<TimelineNode, TimeRange,                 cmp_TimelineNode> _times;
-    std::map<TimelineNode, std::string,               cmp_TimelineNode> _names;
-    std::map<TimelineNode, std::string,               cmp_TimelineNode> _trackKinds;
-    std::map<TimelineNode, NodeKind,                  cmp_TimelineNode> _kinds;
-    void clearMaps() {
+    friend class TimelineCache;
+
+    // Node tables, stored as a struct of arrays. Providers hand out dense,
+    // sequential node ids, so a TimelineNode's id indexes straight into
+    // each table; a node that was never registered reads back as the
+    // default value.
+    std::vector<std::vector<TimelineNode>> _syncStarts;
+    std::vector<std::vector<TimelineNode>> _seqStarts;
+    std::vector<TimeRange>                 _times;
+    std::vector<uint32_t>                  _names;      // handles into _strings
+    std::vector<uint32_t>                  _trackKinds;
+    std::vector<NodeKind>                  _kinds;
+    std::vector<TimelineNode>              _parents;
+    std::vector<std::vector<TimelineNode>> _markers;
+    std::vector<std::vector<TimelineNode>> _effects;
+
+    // Names and track kinds. Never shrinks while the tables are in use,
+    // so a renamed node's old name stays until they are cleared.
+    StringStore                            _strings;
+
+    // Interval index over each sequence's children, parallel to
+    // _seqStarts: the suffix minimum of the children's start times and the
+    // prefix maximum of their end times, in seconds. Both are monotonic even
+    // where transitions overlap their neighbours, so a time window can be
+    // mapped to a range of children with two binary searches.
+    std::vector<std::vector<double>>       _seqMinStarts;
+    std::vector<std::vector<double>>       _seqMaxEnds;
+
+    // Level-of-detail pyramid over each sequence's children, coarsest
+    // last. Only levels that merge more than the one before are kept.
+    std::vector<std::vector<LodLevel>>     _seqLods;
+
+    // Every marker in the document, ordered by start time and then id, and
+    // a revision that changes whenever the order, or a marker's time or
+    // name, does. Revisions are unique across providers.
+    std::vector<TimelineNode>              _markerOrder;
+    uint64_t                               _markerRevision = 0;
+
+    static uint64_t nextRevision() {
+        static std::atomic<uint64_t> revision(0);
+        return ++revision;
+    }
+
+    void clearTables() {
         _syncStarts.clear();
         _seqStarts.clear();
         _times.clear();
         _names.clear();
         _trackKinds.clear();
+        _strings.Clear();
         _kinds.clear();
+        _parents.clear();
+        _markers.clear();
+        _effects.clear();
+        _seqMinStarts.clear();
+        _seqMaxEnds.clear();
+        _seqLods.clear();
+        _markerOrder.clear();
+        _markerRevision = nextRevision();
     }
 
-public:
-    explicit TimelineProvider() {
-        nullName = "<null>";
+    // grow the tables so that node ids below count are addressable
+    void resizeTables(size_t count) {
+        if (count <= _kinds.size())
+            return;
+        _syncStarts.resize(count);
+        _seqStarts.resize(count);
+        _times.resize(count);
+        _names.resize(count, 0);
+        _trackKinds.resize(count, 0);
+        _kinds.resize(count, NodeKind::General);
+        _parents.resize(count, TimelineNodeNull());
+        _markers.resize(count);
+        _effects.resize(count);
+        _seqMinStarts.resize(count);
+        _seqMaxEnds.resize(count);
+        _seqLods.resize(count);
     }
+
+    // build the interval index for a sequence, once its children's times
+    // are known
+    void buildSeqIndex(TimelineNode n) {
+        const auto& children = _seqStarts[n.id];
+        auto& min_starts = _seqMinStarts[n.id];
+        auto& max_ends = _seqMaxEnds[n.id];
+        size_t count = children.size();
+        min_starts.resize(count);
+        max_ends.resize(count);
+
+        double max_end = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < count; ++i) {
+            const auto& range = _times[children[i].id];
+            max_end = std::max(max_end, range.end_time_exclusive().to_seconds());
+            max_ends[i] = max_end;
+        }
+        double min_start = std::numeric_limits<double>::infinity();
+        for (size_t i = count; i > 0; --i) {
+            const auto& range = _times[children[i - 1].id];
+            min_start = std::min(min_start, range.start_time().to_seconds());
+            min_starts[i - 1] = min_start;
+        }
+
+        buildSeqLods(n);
+    }
+
+    static void buildLodIndex(LodLevel& level) {
+        size_t count = level.size();
+        level.minStarts.resize(count);
+        level.maxEnds.resize(count);
+        double max_end = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < count; ++i) {
+            max_end = std::max(max_end, level.ends[i]);
+            level.maxEnds[i] = max_end;
+        }
+        double min_start = std::numeric_limits<double>::infinity();
+        for (size_t i = count; i > 0; --i) {
+            min_start = std::min(min_start, level.starts[i - 1]);
+            level.minStarts[i - 1] = min_start;
+        }
+    }
+
+    // merge the runs of spans that are too small to see at resolution
+    static LodLevel mergeLodLevel(const LodLevel& finer, double resolution) {
+        LodLevel level;
+        level.resolution = resolution;
+        size_t count = finer.size();
+        bool in_run = false;
+        for (size_t i = 0; i < count; ++i) {
+            bool small = finer.ends[i] - finer.starts[i] < resolution;
+            if (small && in_run && finer.starts[i] - level.ends.back() < resolution) {
+                level.count.back() += finer.count[i];
+                level.ends.back() = std::max(level.ends.back(), finer.ends[i]);
+                level.covered.back() += finer.covered[i];
+                continue;
+            }
+            level.first.push_back(finer.first[i]);
+            level.count.push_back(finer.count[i]);
+            level.starts.push_back(finer.starts[i]);
+            level.ends.push_back(finer.ends[i]);
+            level.covered.push_back(finer.covered[i]);
+            in_run = small;
+        }
+        return level;
+    }
+
+    void buildSeqLods(TimelineNode n) {
+        auto& lods = _seqLods[n.id];
+        lods.clear();
+        const auto& children = _seqStarts[n.id];
+        if (children.size() < 2)
+            return;
+
+        // the finest level is just the children themselves
+        LodLevel finest;
+        double first_start = std::numeric_limits<double>::infinity();
+        double last_end = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < children.size(); ++i) {
+            const auto& range = _times[children[i].id];
+            double start = range.start_time().to_seconds();
+            double end = range.end_time_exclusive().to_seconds();
+            finest.first.push_back((uint32_t)i);
+            finest.count.push_back(1);
+            finest.starts.push_back(start);
+            finest.ends.push_back(end);
+            finest.covered.push_back(_kinds[children[i].id] == NodeKind::Gap ? 0.0 : end - start);
+            first_start = std::min(first_start, start);
+            last_end = std::max(last_end, end);
+        }
+
+        for (double resolution = lodBaseResolution;
+             resolution < 2 * (last_end - first_start);
+             resolution *= 2) {
+            const LodLevel& finer = lods.empty() ? finest : lods.back();
+            if (finer.size() <= 1)
+                break;
+            LodLevel level = mergeLodLevel(finer, resolution);
+            if (level.size() == finer.size())
+                continue;
+            buildLodIndex(level);
+            lods.push_back(std::move(level));
+        }
+    }
+
+    bool validNode(TimelineNode n) const {
+        return n.id < _kinds.size();
+    }
+
+    bool isLiveMarker(TimelineNode n) const {
+        return validNode(n) && _kinds[n.id] == NodeKind::Marker
+            && _parents[n.id] != TimelineNodeNull();
+    }
+
+    bool markerBefore(TimelineNode a, TimelineNode b) const {
+        double a_start = _times[a.id].start_time().to_seconds();
+        double b_start = _times[b.id].start_time().to_seconds();
+        if (a_start != b_start)
+            return a_start < b_start;
+        return a.id < b.id;
+    }
+
+    // sort every marker, once the times of the whole document are known
+    void buildMarkerOrder() {
+        _markerOrder.clear();
+        for (uint64_t id = 0; id < _kinds.size(); ++id) {
+            if (isLiveMarker((TimelineNode){id}))
+                _markerOrder.push_back((TimelineNode){id});
+        }
+        std::sort(_markerOrder.begin(), _markerOrder.end(),
+                  [this](TimelineNode a, TimelineNode b) { return markerBefore(a, b); });
+        _markerRevision = nextRevision();
+    }
+
+    // Markers that were added, removed or moved by an edit are taken out
+    // of the order, and the ones still in the document are sorted on their
+    // own and merged back in, leaving the rest of the order alone.
+    void updateMarkerOrder(std::vector<TimelineNode> changed) {
+        if (changed.empty())
+            return;
+        std::sort(changed.begin(), changed.end(), cmp_TimelineNode());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        _markerOrder.erase(std::remove_if(_markerOrder.begin(), _markerOrder.end(),
+                                          [&](TimelineNode n) {
+                                              return std::binary_search(changed.begin(),
+                                                                        changed.end(),
+                                                                        n,
+                                                                        cmp_TimelineNode());
+                                          }),
+                           _markerOrder.end());
+        size_t unchanged = _markerOrder.size();
+        for (auto n : changed) {
+            if (isLiveMarker(n))
+                _markerOrder.push_back(n);
+        }
+        auto before = [this](TimelineNode a, TimelineNode b) { return markerBefore(a, b); };
+        std::sort(_markerOrder.begin() + unchanged, _markerOrder.end(), before);
+        std::inplace_merge(_markerOrder.begin(),
+                           _markerOrder.begin() + unchanged,
+                           _markerOrder.end(),
+                           before);
+        _markerRevision = nextRevision();
+    }
+
+public:
+    explicit TimelineProvider() = default;
     virtual ~TimelineProvider() = default;
 
     TimelineNode HasSequentialSibling(TimelineNode) const;
     TimelineNode HasSynchronousSibling(TimelineNode) const;
-    TimelineNode HasParent(TimelineNode) const;
+    TimelineNode HasParent(TimelineNode n) const {
+        if (!validNode(n))
+            return TimelineNodeNull();
+        return _parents[n.id];
+    }
     
     virtual std::vector<std::string> NodeKindNames() const = 0;
     virtual TimelineNode             RootNode() const = 0;
     virtual TimeRange                TimelineTimeRange() const = 0;
     virtual uint64_t                 StationaryId(TimelineNode) const = 0;
 
-    const std::string& Name(TimelineNode n) const {
-        auto it = _names.find(n);
-        if (it == _names.end())
-            return nullName;
-        return it->second;
+    // Views into the provider's string store, valid until the timeline is
+    // replaced. They are NUL terminated, so data() is a C string.
+    std::string_view Name(TimelineNode n) const {
+        if (!validNode(n))
+            return "<null>";
+        return _strings.View(_names[n.id]);
     }
     NodeKind Kind(TimelineNode n) const {
-        auto it = _kinds.find(n);
-        if (it == _kinds.end())
+        if (!validNode(n))
             return NodeKind::General;
-        return it->second;
+        return _kinds[n.id];
     }
-    const std::string& TrackKind(TimelineNode n) const {
-        auto it = _trackKinds.find(n);
-        if (it == _trackKinds.end())
-            return nullName;
-        return it->second;
+    std::string_view TrackKind(TimelineNode n) const {
+        if (!validNode(n))
+            return "<null>";
+        return _strings.View(_trackKinds[n.id]);
     }
-    std::vector<TimelineNode> SyncStarts(TimelineNode n) const {
-        auto it = _syncStarts.find(n);
-        if (it == _syncStarts.end())
+    // children of a stack, and of a sequence; the spans point into the
+    // provider's own tables, see NodeSpan
+    NodeSpan SyncStarts(TimelineNode n) const {
+        if (!validNode(n))
             return {};
-        return it->second;  // returns a copy
+        return _syncStarts[n.id];
     }
-    std::vector<TimelineNode> SeqStarts(TimelineNode n) const {
-        auto it = _seqStarts.find(n);
-        if (it == _seqStarts.end())
+    NodeSpan SeqStarts(TimelineNode n) const {
+        if (!validNode(n))
             return {};
-        return it->second;  // returns a copy
+        return _seqStarts[n.id];
+    }
+    // markers and effects attached to an item
+    NodeSpan Markers(TimelineNode n) const {
+        if (!validNode(n))
+            return {};
+        return _markers[n.id];
+    }
+    NodeSpan Effects(TimelineNode n) const {
+        if (!validNode(n))
+            return {};
+        return _effects[n.id];
+    }
+    // Returns the half-open range [first, last) of indices into SeqStarts(n)
+    // that may overlap the window [start_seconds, end_seconds]. Children
+    // outside the range are guaranteed not to overlap it.
+    std::pair<size_t, size_t> SeqStartsInRange(TimelineNode n,
+                                               double start_seconds,
+                                               double end_seconds) const {
+        if (!validNode(n))
+            return { 0, 0 };
+        const auto& max_ends = _seqMaxEnds[n.id];
+        const auto& min_starts = _seqMinStarts[n.id];
+        size_t first = std::upper_bound(max_ends.begin(), max_ends.end(), start_seconds)
+                       - max_ends.begin();
+        size_t last = std::upper_bound(min_starts.begin(), min_starts.end(), end_seconds)
+                      - min_starts.begin();
+        return { first, std::max(first, last) };
+    }
+    // The coarsest level of detail that still resolves detail at
+    // pixel_seconds, or nullptr if the children of the sequence are best
+    // drawn one by one.
+    const LodLevel* SeqLod(TimelineNode n, double pixel_seconds) const {
+        if (!validNode(n))
+            return nullptr;
+        const LodLevel* result = nullptr;
+        for (const auto& level : _seqLods[n.id]) {
+            if (level.resolution > pixel_seconds)
+                break;
+            result = &level;
+        }
+        return result;
+    }
+    // every marker in the document, in order of start time
+    const std::vector<TimelineNode>& MarkersByTime() const {
+        return _markerOrder;
+    }
+    uint64_t MarkerRevision() const {
+        return _markerRevision;
     }
     TimeRange NodeTimeRange(TimelineNode n) const {
-        auto it = _times.find(n);
-        if (it == _times.end())
+        if (!validNode(n))
             return TimeRange();
-        return it->second;
+        return _times[n.id];
     }
     RationalTime StartTime(TimelineNode n) const {
-        auto it = _times.find(n);
-        if (it == _times.end())
+        if (!validNode(n))
             return RationalTime();
-        return it->second.start_time();
+        return _times[n.id].start_time();
     }
     RationalTime Duration(TimelineNode n) const {
-        auto it = _times.find(n);
-        if (it == _times.end())
+        if (!validNode(n))
             return RationalTime();
-        return it->second.duration();
+        return _times[n.id].duration();
     }
 };
 
@@ -0,0 +1,492 @@
+// Undo and redo
+
+#include "undo.h"
+#include "app.h"
+#include "editing.h"
+#include "inspector.h"
+
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include <opentimelineio/composition.h>
+#include <opentimelineio/effect.h>
+#include <opentimelineio/stack.h>
+
+#include <deque>
+
+namespace raven {
+
+enum UndoField {
+    UndoField_Name,
+    UndoField_GlobalStart,
+    UndoField_ItemColor,
+    UndoField_SourceRange,
+    UndoField_InOffset,
+    UndoField_OutOffset,
+    UndoField_TimeScalar,
+    UndoField_MarkerColor,
+    UndoField_MarkedRange,
+    UndoField_Child
+};
+
+static const char* undo_field_names[] = {
+    "Rename",
+    "Global Start",
+    "Color",
+    "Trim",
+    "In Offset",
+    "Out Offset",
+    "Time Scale",
+    "Marker Color",
+    "Marked Range",
+    "Insert"
+};
+
+// One side of an edit. Only the members the field uses are set.
+struct UndoValue {
+    bool has_value = true;  // false for an optional that's unset, or a child that's absent
+    std::string text;
+    otio::TimeRange range; // times are kept as the start of a range
+    double number = 0;
+};
+
+struct UndoCommand {
+    UndoField field;
+    // the object that changed, or the parent a child went into or out of
+    otio::SerializableObject::Retainer<otio::SerializableObject> target;
+    UndoValue before;
+    UndoValue after;
+
+    // UndoField_Child
+    AutosaveList list = AutosaveList_Children;
+    int index = 0;
+    otio::SerializableObject::Retainer<otio::SerializableObject> child;
+
+    // The widget that made the edit, while it's still active, so that
+    // further edits from it are folded in. Zero once it's let go.
+    ImGuiID gesture = 0;
+    size_t size = 0;
+};
+
+// Past this, the oldest entries are dropped. The most recent edit is
+// always kept, however large.
+static const size_t undoMemoryBudget = 64 * 1024 * 1024;
+
+// OTIO objects don't report their size, so a removed subtree is charged
+// a rough amount per object in it
+static const size_t undoBytesPerObject = 512;
+
+static std::deque<UndoCommand> undoStack;
+static std::deque<UndoCommand> redoStack;
+static size_t undoMemory = 0;
+
+// An object whose fields were edited but not yet journaled. Edits made
+// while a widget stays active are journaled once, when it's let go, or
+// before anything else is edited.
+static otio::SerializableObject::Retainer<otio::SerializableObject> journalPending;
+
+static void JournalPending() {
+    if (!journalPending)
+        return;
+    auto object = journalPending;
+    journalPending = nullptr;
+    AutosaveObjectChanged(object.value);
+}
+
+static size_t CountObjects(otio::SerializableObject* object) {
+    size_t count = 1;
+    if (const auto& item = dynamic_cast<otio::Item*>(object)) {
+        count += item->markers().size() + item->effects().size();
+    }
+    if (const auto& composition = dynamic_cast<otio::Composition*>(object)) {
+        for (const auto& child : composition->children()) {
+            count += CountObjects(child.value);
+        }
+    }
+    return count;
+}
+
+static size_t CommandSize(const UndoCommand& command) {
+    size_t size = sizeof(UndoCommand)
+        + command.before.text.capacity()
+        + command.after.text.capacity();
+    if (command.child)
+        size += CountObjects(command.child.value) * undoBytesPerObject;
+    return size;
+}
+
+static void TrimUndo() {
+    while (undoStack.size() > 1 && undoMemory > undoMemoryBudget) {
+        undoMemory -= undoStack.front().size;
+        undoStack.pop_front();
+    }
+}
+
+static void ClearRedo() {
+    for (const auto& command : redoStack) {
+        undoMemory -= command.size;
+    }
+    redoStack.clear();
+}
+
+static void InsertIntoList(otio::SerializableObject* parent,
+                           AutosaveList list,
+                           int index,
+                           otio::SerializableObject* child,
+                           otio::ErrorStatus* error_status) {
+    OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
+    if (list == AutosaveList_Children) {
+        auto composition = dynamic_cast<otio::Composition*>(parent);
+        composition->insert_child(index, dynamic_cast<otio::Composable*>(child), error_status);
+        if (otio::is_error(*error_status))
+            return;
+        op->NotifyChildrenChanged(composition);
+    } else {
+        auto item = dynamic_cast<otio::Item*>(parent);
+        if (list == AutosaveList_Markers) {
+            auto& markers = item->markers();
+            markers.insert(markers.begin() + index, dynamic_cast<otio::Marker*>(child));
+        } else {
+            auto& effects = item->effects();
+            effects.insert(effects.begin() + index, dynamic_cast<otio::Effect*>(child));
+        }
+        op->NotifyAnnotationsChanged(item);
+    }
+    AutosaveChildInserted(parent, list, index);
+}
+
+static void RemoveFromList(otio::SerializableObject* parent, AutosaveList list, int index) {
+    OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
+    if (list == AutosaveList_Children) {
+        auto composition = dynamic_cast<otio::Composition*>(parent);
+        composition->remove_child(index);
+        op->NotifyChildrenChanged(composition);
+    } else {
+        auto item = dynamic_cast<otio::Item*>(parent);
+        if (list == AutosaveList_Markers) {
+            auto& markers = item->markers();
+            markers.erase(markers.begin() + index);
+        } else {
+            auto& effects = item->effects();
+            effects.erase(effects.begin() + index);
+        }
+        op->NotifyAnnotationsChanged(item);
+    }
+    AutosaveChildRemoved(parent, list, index);
+}
+
+static void ClearItemColor(otio::Item* item) {
+    if (item->metadata().has_key("raven") &&
+        item->metadata()["raven"].type() == typeid(otio::AnyDictionary))
+    {
+        auto raven_md = otio::any_cast<otio::AnyDictionary>(item->metadata()["raven"]);
+        raven_md.erase("color");
+        item->metadata()["raven"] = raven_md;
+    }
+}
+
+// Set the command's field to value, and tell everyone who needs to know
+static void ApplyValue(const UndoCommand& command, const UndoValue& value) {
+    OTIOProvider* op = appState.timelinePH.Provider<OTIOProvider>();
+    otio::SerializableObject* target = command.target.value;
+    auto time = value.range.start_time();
+    if (journalPending.value != target)
+        JournalPending();
+    DocumentWillChange();
+
+    switch (command.field) {
+    case UndoField_Name: {
+        auto object = dynamic_cast<otio::SerializableObjectWithMetadata*>(target);
+        object->set_name(value.text);
+        op->NotifyNameChanged(object);
+        break;
+    }
+    case UndoField_GlobalStart: {
+        auto timeline = dynamic_cast<otio::Timeline*>(target);
+        if (value.has_value) {
+            timeline->set_global_start_time(time);
+        } else {
+            timeline->set_global_start_time(nonstd::nullopt);
+        }
+        DetectPlayheadLimits();
+        break;
+    }
+    case UndoField_ItemColor: {
+        auto item = dynamic_cast<otio::Item*>(target);
+        if (value.has_value) {
+            SetItemColor(item, value.text);
+        } else {
+            ClearItemColor(item);
+        }
+        break;
+    }
+    case UndoField_SourceRange: {
+        auto item = dynamic_cast<otio::Item*>(target);
+        if (value.has_value) {
+            item->set_source_range(value.range);
+        } else {
+            item->set_source_range(nonstd::nullopt);
+        }
+        op->NotifyTimingChanged(item);
+        DetectPlayheadLimits();
+        break;
+    }
+    case UndoField_InOffset:
+        dynamic_cast<otio::Transition*>(target)->set_in_offset(time);
+        op->NotifyTimingChanged(target);
+        break;
+    case UndoField_OutOffset:
+        dynamic_cast<otio::Transition*>(target)->set_out_offset(time);
+        op->NotifyTimingChanged(target);
+        break;
+    case UndoField_TimeScalar:
+        dynamic_cast<otio::LinearTimeWarp*>(target)->set_time_scalar(value.number);
+        break;
+    case UndoField_MarkerColor:
+        dynamic_cast<otio::Marker*>(target)->set_color(value.text);
+        MarkerColorChanged();
+        break;
+    case UndoField_MarkedRange:
+        dynamic_cast<otio::Marker*>(target)->set_marked_range(value.range);
+        op->NotifyTimingChanged(target);
+        break;
+    case UndoField_Child: {
+        JournalPending();
+        // only replayed from history, where it's known to fit
+        if (value.has_value) {
+            otio::ErrorStatus error_status;
+            InsertIntoList(target, command.list, command.index, command.child, &error_status);
+            SelectObject(command.child);
+        } else {
+            RemoveFromList(target, command.list, command.index);
+            SelectObject(NULL);
+        }
+        return;
+    }
+    }
+    journalPending = target;
+    if (command.gesture == 0)
+        JournalPending();
+}
+
+static void Record(UndoCommand&& command) {
+    ClearRedo();
+
+    // fold into the previous edit, if it's the same widget still going
+    if (!undoStack.empty()) {
+        auto& top = undoStack.back();
+        if (command.gesture != 0
+            && top.gesture == command.gesture
+            && top.field == command.field
+            && top.target.value == command.target.value
+            && command.field != UndoField_Child) {
+            undoMemory -= top.size;
+            top.after = std::move(command.after);
+            top.size = CommandSize(top);
+            undoMemory += top.size;
+            return;
+        }
+    }
+
+    command.size = CommandSize(command);
+    undoMemory += command.size;
+    undoStack.push_back(std::move(command));
+    TrimUndo();
+}
+
+// Apply and record an edit of a field
+static void Edit(UndoField field,
+                 otio::SerializableObject* target,
+                 UndoValue&& before,
+                 UndoValue&& after) {
+    UndoCommand command;
+    command.field = field;
+    command.target = target;
+    command.before = std::move(before);
+    command.after = std::move(after);
+    command.gesture = ImGui::GetActiveID();
+    ApplyValue(command, command.after);
+    Record(std::move(command));
+}
+
+static UndoValue TextValue(const std::string& text) {
+    UndoValue value;
+    value.text = text;
+    return value;
+}
+
+static UndoValue RangeValue(otio::TimeRange range) {
+    UndoValue value;
+    value.range = range;
+    return value;
+}
+
+static UndoValue TimeValue(otio::RationalTime time) {
+    return RangeValue(otio::TimeRange(time));
+}
+
+template<typename T>
+static UndoValue OptionalValue(const T& optional) {
+    UndoValue value;
+    value.has_value = (bool)optional;
+    if (optional)
+        value.range = otio::TimeRange(*optional);
+    return value;
+}
+
+static UndoValue NumberValue(double number) {
+    UndoValue value;
+    value.number = number;
+    return value;
+}
+
+void EditName(otio::SerializableObjectWithMetadata* object, const std::string& name) {
+    Edit(UndoField_Name, object, TextValue(object->name()), TextValue(name));
+}
+
+void EditGlobalStart(otio::Timeline* timeline, otio::RationalTime global_start_time) {
+    Edit(UndoField_GlobalStart,
+         timeline,
+         OptionalValue(timeline->global_start_time()),
+         TimeValue(global_start_time));
+}
+
+void EditItemColor(otio::Item* item, const std::string& color) {
+    UndoValue before = TextValue(GetItemColor(item));
+    before.has_value = before.text != "";
+    Edit(UndoField_ItemColor, item, std::move(before), TextValue(color));
+}
+
+void EditSourceRange(otio::Item* item, otio::TimeRange source_range) {
+    Edit(UndoField_SourceRange,
+         item,
+         OptionalValue(item->source_range()),
+         RangeValue(source_range));
+}
+
+void EditInOffset(otio::Transition* transition, otio::RationalTime in_offset) {
+    Edit(UndoField_InOffset, transition, TimeValue(transition->in_offset()), TimeValue(in_offset));
+}
+
+void EditOutOffset(otio::Transition* transition, otio::RationalTime out_offset) {
+    Edit(UndoField_OutOffset, transition, TimeValue(transition->out_offset()), TimeValue(out_offset));
+}
+
+void EditTimeScalar(otio::LinearTimeWarp* timewarp, double time_scalar) {
+    Edit(UndoField_TimeScalar, timewarp, NumberValue(timewarp->time_scalar()), NumberValue(time_scalar));
+}
+
+void EditMarkerColor(otio::Marker* marker, const std::string& color) {
+    Edit(UndoField_MarkerColor, marker, TextValue(marker->color()), TextValue(color));
+}
+
+void EditMarkedRange(otio::Marker* marker, otio::TimeRange marked_range) {
+    Edit(UndoField_MarkedRange, marker, RangeValue(marker->marked_range()), RangeValue(marked_range));
+}
+
+bool EditInsertChild(
+    otio::SerializableObject* parent,
+    AutosaveList list,
+    int index,
+    otio::SerializableObject* child,
+    otio::ErrorStatus* error_status) {
+    UndoCommand command;
+    command.field = UndoField_Child;
+    command.target = parent;
+    command.list = list;
+    command.index = index;
+    command.child = child;
+    command.before.has_value = false;
+
+    JournalPending();
+    DocumentWillChange();
+    InsertIntoList(parent, list, index, child, error_status);
+    if (otio::is_error(*error_status))
+        return false;
+    Record(std::move(command));
+    return true;
+}
+
+void EditRemoveChild(otio::SerializableObject* parent, AutosaveList list, int index) {
+    UndoCommand command;
+    command.field = UndoField_Child;
+    command.target = parent;
+    command.list = list;
+    command.index = index;
+    command.after.has_value = false;
+    if (list == AutosaveList_Children) {
+        command.child = dynamic_cast<otio::Composition*>(parent)->children()[index].value;
+    } else if (list == AutosaveList_Markers) {
+        command.child = dynamic_cast<otio::Item*>(parent)->markers()[index].value;
+    } else {
+        command.child = dynamic_cast<otio::Item*>(parent)->effects()[index].value;
+    }
+
+    JournalPending();
+    DocumentWillChange();
+    RemoveFromList(parent, list, index);
+    SelectObject(NULL);
+    Record(std::move(command));
+}
+
+static const char* CommandName(const UndoCommand& command) {
+    if (command.field == UndoField_Child && command.before.has_value)
+        return "Delete";
+    return undo_field_names[command.field];
+}
+
+bool CanUndo() {
+    return !undoStack.empty();
+}
+
+bool CanRedo() {
+    return !redoStack.empty();
+}
+
+const char* UndoName() {
+    return undoStack.empty() ? "" : CommandName(undoStack.back());
+}
+
+const char* RedoName() {
+    return redoStack.empty() ? "" : CommandName(redoStack.back());
+}
+
+void Undo() {
+    if (undoStack.empty())
+        return;
+    auto command = std::move(undoStack.back());
+    undoStack.pop_back();
+    command.gesture = 0;
+    ApplyValue(command, command.before);
+    redoStack.push_back(std::move(command));
+}
+
+void Redo() {
+    if (redoStack.empty())
+        return;
+    auto command = std::move(redoStack.back());
+    redoStack.pop_back();
+    ApplyValue(command, command.after);
+    undoStack.push_back(std::move(command));
+}
+
+void UndoUpdate() {
+    if (!undoStack.empty() && undoStack.back().gesture != ImGui::GetActiveID())
+        undoStack.back().gesture = 0;
+    if (undoStack.empty() || undoStack.back().gesture == 0)
+        JournalPending();
+}
+
+void ClearUndo() {
+    // the edit belongs to the document that's going
+    JournalPending();
+    undoStack.clear();
+    redoStack.clear();
+    undoMemory = 0;
+}
+
+size_t UndoMemoryUsed() {
+    return undoMemory;
+}
+
+} // raven
@@ -0,0 +1,67 @@
+// Undo and redo
+#ifndef RAVEN_UNDO_H
+#define RAVEN_UNDO_H
+
+#include "autosave.h"
+
+#include <opentimelineio/item.h>
+#include <opentimelineio/linearTimeWarp.h>
+#include <opentimelineio/marker.h>
+#include <opentimelineio/timeline.h>
+#include <opentimelineio/transition.h>
+namespace otio = opentimelineio::OPENTIMELINEIO_VERSION;
+
+#include <stddef.h>
+#include <string>
+
+namespace raven {
+
+// Every edit to the document goes through one of these. Each applies the
+// change, notifies the provider and the autosave journal, and records
+// the values it changed from and to, so it can be undone. Objects that
+// are removed are held on to, not copied, so undoing a delete puts back
+// the very same object.
+//
+// Repeated edits to the same field from one widget, while it stays active
+// (e.g. dragging a time, or typing a name), are coalesced into a single
+// entry. History is dropped, oldest first, past a memory budget.
+
+void EditName(otio::SerializableObjectWithMetadata* object, const std::string& name);
+void EditGlobalStart(otio::Timeline* timeline, otio::RationalTime global_start_time);
+void EditItemColor(otio::Item* item, const std::string& color);
+void EditSourceRange(otio::Item* item, otio::TimeRange source_range);
+void EditInOffset(otio::Transition* transition, otio::RationalTime in_offset);
+void EditOutOffset(otio::Transition* transition, otio::RationalTime out_offset);
+void EditTimeScalar(otio::LinearTimeWarp* timewarp, double time_scalar);
+void EditMarkerColor(otio::Marker* marker, const std::string& color);
+void EditMarkedRange(otio::Marker* marker, otio::TimeRange marked_range);
+
+// Insert child at index in one of parent's lists, or remove the one that's
+// there, which also clears the selection. Undoing either selects whatever
+// is back in the list.
+bool EditInsertChild(
+    otio::SerializableObject* parent,
+    AutosaveList list,
+    int index,
+    otio::SerializableObject* child,
+    otio::ErrorStatus* error_status);
+void EditRemoveChild(otio::SerializableObject* parent, AutosaveList list, int index);
+
+bool CanUndo();
+bool CanRedo();
+// What would be undone or redone, e.g. "Rename", for the menu
+const char* UndoName();
+const char* RedoName();
+void Undo();
+void Redo();
+
+// Call once per frame, to end a coalesced edit once its widget is let go
+void UndoUpdate();
+// Forget all history, when the document is replaced
+void ClearUndo();
+// An estimate of the memory the history holds
+size_t UndoMemoryUsed();
+
+} // raven
+
+#endif